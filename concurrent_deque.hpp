@@ -0,0 +1,242 @@
+#ifndef SJTU_CONCURRENT_DEQUE_HPP
+#define SJTU_CONCURRENT_DEQUE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+
+#include "deque.hpp"
+
+namespace sjtu {
+
+    /**
+     * Deque safe for any number of threads at both ends.
+     * The elements lie in a chain of fixed size blocks, each with its own
+     * mutex. One lock guards the head end and another the tail end, so
+     * threads at the front and threads at the back only meet when both
+     * ends are in the same block.
+     * Blocks are added and dropped at the ends only. Dropping an empty end
+     * block takes the lock of that block and of its one neighbour, never
+     * anything else.
+     * Lock order: an end lock first, then block locks from front to back.
+     * pop_back needs a block's left neighbour while holding the block, so
+     * it only try_locks it and starts over when that fails.
+     */
+    template <class T, class Allocator = std::allocator<T>, class BlockPolicy = byte_blocks<>>
+    class concurrent_deque {
+    private:
+        struct block {
+            std::mutex m;
+            T *buf;
+            int lo, hi;  //elements are buf[lo, hi)
+            block *prev, *next;
+        };
+
+        typedef std::allocator_traits<Allocator> traits;
+        typedef typename traits::template rebind_alloc<block> block_allocator;
+        typedef std::allocator_traits<block_allocator> block_traits;
+
+        Allocator alloc;
+        int cap;
+        alignas(64) std::mutex hm;  //guards head
+        block *head;
+        alignas(64) std::mutex tm;  //guards tail
+        block *tail;
+
+        //A new empty block whose elements will start at lo
+        block *makeBlock(int lo) {
+            block_allocator ba(alloc);
+            block *x = block_traits::allocate(ba, 1);
+            try {
+                x->buf = traits::allocate(alloc, cap);
+            } catch (...) {
+                block_traits::deallocate(ba, x, 1);
+                throw;
+            }
+            new (&x->m) std::mutex();
+            x->lo = x->hi = lo;
+            x->prev = x->next = nullptr;
+            return x;
+        }
+
+        void freeBlock(block *x) {
+            for (int i = x->lo; i < x->hi; i++) traits::destroy(alloc, x->buf + i);
+            traits::deallocate(alloc, x->buf, cap);
+            x->m.~mutex();
+            block_allocator ba(alloc);
+            block_traits::deallocate(ba, x, 1);
+        }
+
+        //An empty block alone in the chain may as well start over in the middle
+        void recenter(block *x) {
+            if (x->lo == x->hi && !x->prev && !x->next) x->lo = x->hi = cap / 2;
+        }
+
+    public:
+        explicit concurrent_deque(const Allocator &alloc = Allocator())
+            : alloc(alloc), cap(2 * BlockPolicy::size(0, sizeof(T))) {
+            head = tail = makeBlock(cap / 2);
+        }
+
+        concurrent_deque(const concurrent_deque &) = delete;
+        concurrent_deque &operator=(const concurrent_deque &) = delete;
+
+        /**
+         * No other thread may be using the deque any more.
+         */
+        ~concurrent_deque() {
+            for (block *x = head; x; ) {
+                block *tmp = x->next;
+                freeBlock(x);
+                x = tmp;
+            }
+        }
+
+        template <class... Args>
+        void emplace_back(Args &&... args) {
+            std::lock_guard<std::mutex> end(tm);
+            block *x = tail;
+            std::lock_guard<std::mutex> lock(x->m);
+            if (x->hi == cap) {
+                block *y = makeBlock(0);
+                try {
+                    traits::construct(alloc, y->buf, std::forward<Args>(args)...);
+                } catch (...) {
+                    freeBlock(y);
+                    throw;
+                }
+                y->hi = 1;
+                y->prev = x;
+                x->next = y;
+                tail = y;
+                return;
+            }
+            traits::construct(alloc, x->buf + x->hi, std::forward<Args>(args)...);
+            x->hi++;
+        }
+
+        template <class... Args>
+        void emplace_front(Args &&... args) {
+            std::lock_guard<std::mutex> end(hm);
+            block *x = head;
+            std::lock_guard<std::mutex> lock(x->m);
+            if (x->lo == 0) {
+                block *y = makeBlock(cap);
+                try {
+                    traits::construct(alloc, y->buf + cap - 1, std::forward<Args>(args)...);
+                } catch (...) {
+                    freeBlock(y);
+                    throw;
+                }
+                y->lo = cap - 1;
+                y->next = x;
+                x->prev = y;
+                head = y;
+                return;
+            }
+            traits::construct(alloc, x->buf + x->lo - 1, std::forward<Args>(args)...);
+            x->lo--;
+        }
+
+        void push_back(const T &value) {
+            emplace_back(value);
+        }
+        void push_back(T &&value) {
+            emplace_back(std::move(value));
+        }
+        void push_front(const T &value) {
+            emplace_front(value);
+        }
+        void push_front(T &&value) {
+            emplace_front(std::move(value));
+        }
+
+        /**
+         * Move the front element into out and remove it.
+         * Returns false, leaving out alone, if the deque is empty.
+         */
+        bool try_pop_front(T &out) {
+            std::lock_guard<std::mutex> end(hm);
+            for (;;) {
+                block *x = head;
+                std::unique_lock<std::mutex> lock(x->m);
+                if (x->lo < x->hi) {
+                    T &v = x->buf[x->lo];
+                    out = std::move(v);
+                    traits::destroy(alloc, &v);
+                    x->lo++;
+                    recenter(x);
+                    return true;
+                }
+                block *y = x->next;
+                if (!y) return false;
+                //Drop the empty head block, holding it and its successor
+                std::lock_guard<std::mutex> next(y->m);
+                y->prev = nullptr;
+                head = y;
+                recenter(y);
+                lock.unlock();
+                freeBlock(x);
+            }
+        }
+
+        /**
+         * Move the back element into out and remove it.
+         * Returns false, leaving out alone, if the deque is empty.
+         */
+        bool try_pop_back(T &out) {
+            std::lock_guard<std::mutex> end(tm);
+            for (;;) {
+                block *x = tail;
+                std::unique_lock<std::mutex> lock(x->m);
+                if (x->lo < x->hi) {
+                    T &v = x->buf[x->hi - 1];
+                    out = std::move(v);
+                    traits::destroy(alloc, &v);
+                    x->hi--;
+                    recenter(x);
+                    return true;
+                }
+                block *y = x->prev;
+                if (!y) return false;
+                //Drop the empty tail block. y is to the left of x, so it is
+                //only tried; it cannot go away while x is held.
+                std::unique_lock<std::mutex> prev(y->m, std::try_to_lock);
+                if (!prev.owns_lock()) {
+                    lock.unlock();
+                    std::this_thread::yield();
+                    continue;
+                }
+                y->next = nullptr;
+                tail = y;
+                recenter(y);
+                lock.unlock();
+                freeBlock(x);
+            }
+        }
+
+        /**
+         * Whether the deque held no element at some moment during the call.
+         */
+        bool empty() {
+            std::lock_guard<std::mutex> end(hm);
+            block *x = head;
+            std::unique_lock<std::mutex> lock(x->m);
+            for (;;) {
+                if (x->lo < x->hi) return false;
+                block *y = x->next;
+                if (!y) return true;
+                //Hand over hand, so that y cannot be dropped under us
+                std::unique_lock<std::mutex> next(y->m);
+                lock.swap(next);
+                x = y;
+            }
+        }
+    };
+
+}  // namespace sjtu
+
+#endif
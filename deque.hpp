@@ -1,17 +1,40 @@
 #ifndef SJTU_DEQUE_HPP
 #define SJTU_DEQUE_HPP
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cmath>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define SJTU_DEQUE_HAS_PMR
+#endif
+#endif
 
 #include "exceptions.hpp"
 
 namespace sjtu {
 
+    /**
+     * Node of a circular doubly linked list, holding its T in place.
+     * Nodes never own their neighbours: the deque carves them out of its
+     * slab and hands every one back there, so a node is only destroyed
+     * once it is out of any ring.
+     */
     template <class T>
     class list {
 	private:
 
+        //Storage for the T constructed in place
+        alignas(T) unsigned char storage[sizeof(T)];
+
 		void dislink() {
             if (prev) prev->next = next;
             if (next) next->prev = prev;
@@ -20,25 +43,21 @@ namespace sjtu {
 
     public:
 
-		static void erase(list<T> *p) {
+        struct inplace {};
+
+		static list<T>* detach(list<T> *p) {
 			p->dislink();
-			delete p;
+			return p;
 		}
 
         T *data;
         list *next, *prev;
-        list() : data(nullptr) {
-            next = prev = this;
-        }
-        list(T *data) : data(data) {
-            next = prev = this;
-        }
-        list(const T &data) : data(new T(data)){
-            next = prev = this;
-        }
-        list(T &&data) : data(new T(std::move(data))) {
+        template <class... Args>
+        list(inplace, Args&&... args) : data(new (storage) T(std::forward<Args>(args)...)) {
             next = prev = this;
         }
+        list(const list &) = delete;
+        list &operator=(const list &) = delete;
 
         void insert_after(list *after) {
             after->next = this->next;
@@ -75,177 +94,908 @@ namespace sjtu {
         }
 
         ~list() {
-            if (data) {
-                delete data;
-                data = nullptr;
-            }
-            if (next && next!=this) {
-                list *tmp = next;
-				dislink();
-                delete tmp;
-            }
-            if (prev && prev!=this) {
-                list *tmp = prev;
-				dislink();
-                delete tmp;
-            }
+            data->~T();
         }
     };
 
-    template <class T>
+    /**
+     * Block size policies for deque.
+     * A policy has a static int size(int n, std::size_t bytes) giving the
+     * target number of elements per block for n elements of bytes each;
+     * blocks are then kept between size and 2*size elements.
+     * Any type of that shape can be passed as BlockPolicy.
+     */
+
+    //N elements per block whatever the size, suits queue-like use
+    template <int N = 128>
+    struct fixed_blocks {
+        static int size(int, std::size_t) {
+            return N;
+        }
+    };
+
+    //About sqrt(n) elements per block but at least N, suits random inserts
+    template <int N = 128>
+    struct sqrt_blocks {
+        static int size(int n, std::size_t) {
+            return N*N < n ? (int)std::sqrt((double)n) : N;
+        }
+    };
+
+    //A full block takes about Bytes bytes, e.g. 32768 to stay in L1
+    template <std::size_t Bytes = 32768>
+    struct byte_blocks {
+        static int size(int, std::size_t bytes) {
+            std::size_t n = Bytes / (2*bytes);
+            return n < 8 ? 8 : n > (1 << 20) ? (1 << 20) : (int)n;
+        }
+    };
+
+    /**
+     * Wrapping a policy in incremental_blocks spreads splits and merges out:
+     * each becomes a job that moves a few elements on each following
+     * operation, and gets the buffer it needs when it starts, so no
+     * operation moves more than a handful of elements between blocks.
+     * Only those element moves are bounded. A job that adds or drops a
+     * block at either end of the deque keeps the block directory current
+     * in O(log blocks), but anywhere else it leaves the directory to be
+     * rebuilt in O(blocks) by the next lookup by position (at(),
+     * operator[], iterator arithmetic). A block that fills up while
+     * another job is pending still has its buffer grown in O(block size).
+     */
+    template <class Policy = sqrt_blocks<>>
+    struct incremental_blocks : Policy {
+        static const bool incremental = true;
+    };
+
+    template <class Policy, class = void>
+    struct is_incremental : std::false_type {};
+    template <class Policy>
+    struct is_incremental<Policy, decltype(void(Policy::incremental))> : std::integral_constant<bool, Policy::incremental> {};
+
+    template <class T, class Allocator = std::allocator<T>, class BlockPolicy = sqrt_blocks<>>
     class deque {
     private:
-        static const int BSIZE = 128;
 
-		struct block;
-		struct node : list<T> {
-			list<block> *from;
+        /**
+         * A block keeps its elements in one contiguous buffer of cap slots,
+         * used as a circular buffer starting at beg, so that both ends can
+         * grow in O(1) and a scan over the block is a linear walk.
+         * The buffer itself is owned by the slab, the block only constructs
+         * and destroys elements in it and never grows it. Elements are
+         * constructed and destroyed through the deque's allocator a, which
+         * the slab holds, so that e.g. pmr elements use the same resource.
+         */
+        struct block {
+            typedef std::allocator_traits<Allocator> traits;
 
-			node() : list<T>(), from(nullptr) {}
-			node(T *data) : list<T>(data), from(nullptr) {}
-			node(const T &data) : list<T>(data), from(nullptr) {}
-			node(list<block> *from) : list<T>(), from(from) {}
-		};
+            T *buf;
+            int cap, beg, size;
+            int id, fsize;  //position in the directory, size as last counted there
 
-        static node* cas(list<T> *p) {
-            return reinterpret_cast<node *>(p);
-        }
+			block() : buf(nullptr), cap(0), beg(0), size(0), id(0), fsize(0) {}
 
-        static const node* cas(const list<T> *p) {
-            return reinterpret_cast<const node *>(p);
-        }
-        
-        static list<block>* nfrom(list<T> *p) {
-            return reinterpret_cast<node *>(p)->from;
-        }
+            int slot(int i) const {
+                i += beg;
+                return i >= cap ? i - cap : i;
+            }
 
-        static const list<block>* nfrom(const list<T> *p) {
-            return reinterpret_cast<const node *>(p)->from;
-        }
+            T &at(int i) {
+                return buf[slot(i)];
+            }
 
-        struct block { 
-            node head;
-            int size;
+            const T &at(int i) const {
+                return buf[slot(i)];
+            }
 
-			block() : size(0) {}
+            void clear(Allocator &a) {
+                if (!std::is_trivially_destructible<T>::value) {
+                    for (int i = 0; i < size; i++) traits::destroy(a, &at(i));
+                }
+                size = beg = 0;
+            }
 
-            block *link_after(block *x) {
-                x->head.next->prev = head.prev;
-                x->head.prev->next = &head;
-                head.prev->next = x->head.next;
-                head.prev = x->head.prev;
+            //Move all elements of x to the back of this block, x is left empty
+            block *link_after(Allocator &a, block *x) {
+                for (int i = 0; i < x->size; i++) {
+                    traits::construct(a, buf + slot(size + i), std::move(x->at(i)));
+                }
                 size += x->size;
-                x->head.next = x->head.prev = &x->head;
-                x->size = 0;
-				delete x;
+                x->clear(a);
                 return this;
             }
 
-            block *cut_after(int pos) {
-                list<T> *p = head.next_nth(pos);
-                block *x = new block();
-                x->head.next = p->next;
-                x->head.prev = head.prev;
-                x->head.next->prev = x->head.prev->next = &x->head;
+            //Move elements [pos, size) to the empty block x
+            block *cut_after(Allocator &a, int pos, block *x) {
+                for (int i = pos; i < size; i++) {
+                    traits::construct(a, x->buf + i - pos, std::move(at(i)));
+                }
+                x->beg = 0;
                 x->size = size - pos;
-                p->next = &head;
-                head.prev = p;
-                size = pos;
-				return x;
+                while (size > pos) pop_back(a);
+                return x;
             }
 
-			//Insert before
-			list<T>* insert_before(list<T> *p, const T &data) {
-				size++;
-                node *x = new node(data);
-				p->insert_before(x);
+            //Move elements [0, pos) to the empty block x
+            block *cut_before(Allocator &a, int pos, block *x) {
+                for (int i = 0; i < pos; i++) {
+                    traits::construct(a, x->buf + i, std::move(at(i)));
+                }
+                x->beg = 0;
+                x->size = pos;
+                for (int i = 0; i < pos; i++) pop_front(a);
                 return x;
+            }
+
+			//Construct before index i, there must be a free slot
+            template <class... Args>
+			T* emplace(Allocator &a, int i, Args&&... args) {
+                if (i == size) {
+                    traits::construct(a, buf + slot(size), std::forward<Args>(args)...);
+                    size++;
+                } else if (i == 0) {
+                    int nbeg = beg ? beg - 1 : cap - 1;
+                    traits::construct(a, buf + nbeg, std::forward<Args>(args)...);
+                    beg = nbeg;
+                    size++;
+                } else if (i < size - i) {
+                    T tmp(std::forward<Args>(args)...);
+                    int nbeg = beg ? beg - 1 : cap - 1;
+                    traits::construct(a, buf + nbeg, std::move(buf[beg]));
+                    beg = nbeg;
+                    size++;
+                    for (int k = 1; k < i; k++) at(k) = std::move(at(k + 1));
+                    at(i) = std::move(tmp);
+                } else {
+                    T tmp(std::forward<Args>(args)...);
+                    traits::construct(a, buf + slot(size), std::move(at(size - 1)));
+                    size++;
+                    for (int k = size - 2; k > i; k--) at(k) = std::move(at(k - 1));
+                    at(i) = std::move(tmp);
+                }
+                return &at(i);
 			}
 
-			//Erase
-			void erase(list<T> *p) {
-				size--;
-				node::erase(cas(p));
+			//Erase, the following element moves to index i
+			void erase(Allocator &a, int i) {
+                if (i < size - 1 - i) {
+                    for (int k = i; k > 0; k--) at(k) = std::move(at(k - 1));
+                    pop_front(a);
+                } else {
+                    for (int k = i; k < size - 1; k++) at(k) = std::move(at(k + 1));
+                    pop_back(a);
+                }
 			}
 
-            void pop_front() {
+            void pop_front(Allocator &a) {
+                traits::destroy(a, buf + beg);
+                beg = beg + 1 == cap ? 0 : beg + 1;
                 size--;
-				node::erase(cas(head->next));
             }
 
-            void push_front(const T &data) {
-                size++;
-                head.insert_after(new node(data));
+            void push_front(Allocator &a, const T &data) {
+                emplace(a, 0, data);
             }
 
-            void pop_back() {
+            void pop_back(Allocator &a) {
+                traits::destroy(a, &at(size - 1));
                 size--;
-				list<node>::erase(cas(head->prev));
             }
 
-            void push_back(const T &data) {
-                size++;
-                head.insert_before(new node(data));
+            void push_back(Allocator &a, const T &data) {
+                emplace(a, size, data);
+            }
+        };
+
+        /**
+         * Slab for the block ring.
+         * Nodes are carved out of chunks of CHUNK nodes. A released node waits
+         * on a free list (threaded through next) until makeBlock() hands it
+         * out again. Up to SPARE of them keep their element buffer, so steady
+         * push/pop churn does not reach the global allocator, while a deque
+         * that shrank for good gives its buffers back.
+         * release() returns every chunk and buffer at once.
+         * Chunks and buffers come from Allocator, rebound as needed.
+         */
+        struct slab {
+            static const int CHUNK = 32;
+            static const int SPARE = 16;
+
+            struct chunk {
+                chunk *next;
+                alignas(list<block>) unsigned char nodes[CHUNK * sizeof(list<block>)];
+            };
+
+            typedef std::allocator_traits<Allocator> traits;
+            typedef typename traits::template rebind_alloc<chunk> chunk_allocator;
+            typedef std::allocator_traits<chunk_allocator> chunk_traits;
+
+            Allocator alloc;
+            chunk *chunks, *clast;
+            list<block> *avail, *alast;  //clast, alast: list tails, so adopt() is O(1)
+            int used, spare;  //spare: nodes on avail holding a buffer
+            mutable size_t allocs, frees;
+
+            slab(const Allocator &alloc) : alloc(alloc), chunks(nullptr), clast(nullptr), avail(nullptr), alast(nullptr), used(CHUNK), spare(0), allocs(0), frees(0) {}
+
+            ~slab() {
+                release();
+            }
+
+            T *allocate(int n) {
+                allocs++;
+                return traits::allocate(alloc, n);
+            }
+
+            void deallocate(T *p, int n) {
+                if (!p) return;
+                frees++;
+                traits::deallocate(alloc, p, n);
+            }
+
+            template <class U>
+            U *allocate_array(int n) const {
+                typename traits::template rebind_alloc<U> a(alloc);
+                allocs++;
+                return std::allocator_traits<decltype(a)>::allocate(a, n);
+            }
+
+            template <class U>
+            void deallocate_array(U *p, int n) const {
+                if (!p) return;
+                typename traits::template rebind_alloc<U> a(alloc);
+                frees++;
+                std::allocator_traits<decltype(a)>::deallocate(a, p, n);
+            }
+
+            //Grow the buffer of b to at least n slots
+            void reserve(block *b, int n) {
+                if (n <= b->cap) return;
+                T *nbuf = allocate(n);
+                for (int i = 0; i < b->size; i++) {
+                    traits::construct(alloc, nbuf + i, std::move(b->at(i)));
+                    traits::destroy(alloc, &b->at(i));
+                }
+                deallocate(b->buf, b->cap);
+                b->buf = nbuf;
+                b->cap = n;
+                b->beg = 0;
+            }
+
+            list<block>* get(int cap) {
+                list<block> *x;
+                if (avail) {
+                    x = avail;
+                    avail = avail->next;
+                    if (!avail) alast = nullptr;
+                    x->next = x->prev = x;
+                    if (x->data->buf) spare--;
+                } else {
+                    if (used == CHUNK) {
+                        chunk_allocator a(alloc);
+                        chunk *c = chunk_traits::allocate(a, 1);
+                        allocs++;
+                        c->next = chunks;
+                        chunks = c;
+                        if (!clast) clast = c;
+                        used = 0;
+                    }
+                    x = new (chunks->nodes + sizeof(list<block>) * used++) list<block>(typename list<block>::inplace());
+                }
+                if (cap) {
+                    try {
+                        reserve(x->data, cap);
+                    } catch (...) {
+                        put(x);
+                        throw;
+                    }
+                }
+                return x;
+            }
+
+            //Exchange everything but the allocators, see deque::swap
+            void swap(slab &other) noexcept {
+                std::swap(chunks, other.chunks);
+                std::swap(clast, other.clast);
+                std::swap(avail, other.avail);
+                std::swap(alast, other.alast);
+                std::swap(used, other.used);
+                std::swap(spare, other.spare);
+                std::swap(allocs, other.allocs);
+                std::swap(frees, other.frees);
+            }
+
+            //Take over the chunks, spare nodes and counts of other, which is left empty
+            void adopt(slab &other) {
+                //other's chunks go after our first one, which stays the one being carved
+                if (other.chunks) {
+                    if (chunks) {
+                        other.clast->next = chunks->next;
+                        chunks->next = other.chunks;
+                        if (clast == chunks) clast = other.clast;
+                    } else {
+                        chunks = other.chunks;
+                        clast = other.clast;
+                        used = other.used;
+                    }
+                }
+                if (other.avail) {
+                    other.alast->next = avail;
+                    if (!avail) alast = other.alast;
+                    avail = other.avail;
+                }
+                spare += other.spare;
+                allocs += other.allocs;
+                frees += other.frees;
+                other.chunks = other.clast = nullptr;
+                other.avail = other.alast = nullptr;
+                other.used = CHUNK;
+                other.spare = 0;
+                other.allocs = other.frees = 0;
+            }
+
+            /**
+             * Hand the contents of the unlinked node x to a node of slab to,
+             * swapping buffers so that no element moves, and keep x as spare.
+             * The counts follow the buffers.
+             */
+            list<block>* transfer(list<block> *x, slab &to) {
+                list<block> *y = to.get(0);
+                block *a = x->data, *b = y->data;
+                if (a->buf) {
+                    allocs--;
+                    to.allocs++;
+                }
+                if (b->buf) {
+                    to.allocs--;
+                    allocs++;
+                }
+                std::swap(a->buf, b->buf);
+                std::swap(a->cap, b->cap);
+                std::swap(a->beg, b->beg);
+                std::swap(a->size, b->size);
+                put(x);
+                return y;
+            }
+
+            //x must be unlinked and its block empty
+            void put(list<block> *x) {
+                if (x->data->buf) {
+                    if (spare < SPARE) {
+                        spare++;
+                    } else {
+                        deallocate(x->data->buf, x->data->cap);
+                        x->data->buf = nullptr;
+                        x->data->cap = 0;
+                    }
+                }
+                x->next = avail;
+                if (!avail) alast = x;
+                avail = x;
+            }
+
+            //Destroy the unlinked node x with its elements and buffer
+            void destroy(list<block> *x) {
+                x->next = x->prev = x;
+                x->data->clear(alloc);
+                deallocate(x->data->buf, x->data->cap);
+                x->~list<block>();
+            }
+
+            //Every node must have been put back or destroyed
+            void release() {
+                for (; avail; ) {
+                    list<block> *x = avail;
+                    avail = avail->next;
+                    destroy(x);
+                }
+                for (; chunks; ) {
+                    chunk *c = chunks;
+                    chunks = chunks->next;
+                    chunk_allocator a(alloc);
+                    chunk_traits::deallocate(a, c, 1);
+                    frees++;
+                }
+                clast = nullptr;
+                alast = nullptr;
+                used = CHUNK;
+                spare = 0;
             }
         };
 
+        /**
+         * Directory of the block ring for positional access: the blocks sit
+         * in dir[dlo, dhi) in order, the slots around them are empty, and
+         * fen is a Fenwick tree over the sizes of all dcap slots.
+         * A size change is pushed into fen by refresh() in O(log blocks), and
+         * so is a block added or dropped at either end while there is a free
+         * slot on that side. Any other split, merge or erase only marks the
+         * directory stale and the next lookup rebuilds it in one pass, which
+         * leaves free slots on both sides.
+         * version counts those structural changes, an iterator made under the
+         * current version still names a live block without further checks.
+         * Const lookups may run in several threads at once, so the rebuild
+         * they trigger is guarded by the building flag, see directory().
+         */
         list<block> bs;
+        slab mem;
         int size_c, bsize;
+        int blo, bhi;  //bsize was picked by the policy for size_c in [blo, bhi]
+        mutable list<block> **dir;
+        mutable int *fen;
+        mutable int dlo, dhi, dcap;
+        mutable std::atomic<bool> stale, building = {false};
+        unsigned version;
+        int batch;  //live batch_guards, splits and merges wait for rebalance()
 
-		static list<block>* assignBlock(list<block> *x) {
-            x->data->head.from = x;
+        /**
+         * Incremental mode, see incremental_blocks.
+         * The pending job moves elements from block src to its neighbour dst,
+         * STEP of them per update(), until left is 0 or src runs empty.
+         * Moving the back of src to the front of dst splits src, moving its
+         * front to the back of dst merges it. Every step leaves a valid ring,
+         * so a job can be dropped at any time.
+         */
+        static const bool INCREMENTAL = is_incremental<BlockPolicy>::value;
+        static const int STEP = 4;
+        struct job {
+            list<block> *src, *dst;
+            int left;
+        } work = {nullptr, nullptr, 0};
+
+        //Link a new empty block in before y and return it
+		list<block>* makeBlock(list<block> *y) {
+            list<block> *x = mem.get(2*bsize+1);
+            y->insert_before(x);
+            version++;
+            if (stale.load(std::memory_order_relaxed)) return x;
+            int id;
+            if (x->next == &bs && dhi < dcap) {
+                id = dhi++;
+            } else if (x->prev == &bs && dlo > 0) {
+                id = --dlo;
+            } else {
+                stale.store(true, std::memory_order_relaxed);
+                return x;
+            }
+            x->data->id = id;
+            x->data->fsize = 0;
+            dir[id] = x;
 			return x;
 		}
 
-		static list<block>* makeBlock(block *x) {
-			return assignBlock(new list<block>(x));
-		}
+        void freeBlock(list<block> *x) {
+            if (x == work.src || x == work.dst) work.src = work.dst = nullptr;
+            version++;
+            if (!stale.load(std::memory_order_relaxed)) {
+                block *b = x->data;
+                if (b->id == dhi-1 || b->id == dlo) {
+                    for (int i = b->id+1; i <= dcap; i += i & -i) fen[i] -= b->fsize;
+                    dir[b->id] = nullptr;
+                    if (b->id == dlo) dlo++;
+                    else dhi--;
+                } else {
+                    stale.store(true, std::memory_order_relaxed);
+                }
+            }
+            x->data->clear(mem.alloc);
+            list<block>::detach(x);
+            mem.put(x);
+        }
 
-		static list<block>* makeBlock() {
-			return assignBlock(new list<block>(new block()));
-		}
+        /**
+         * Construct into block x, growing its buffer if it is full.
+         * An empty x was just made for this element, so if construction
+         * throws x is freed again rather than left empty in the ring.
+         */
+        template <class... Args>
+        void place(list<block> *x, int pos, Args&&... args) {
+            try {
+                if (x->data->size == x->data->cap) {
+                    T tmp(std::forward<Args>(args)...);
+                    mem.reserve(x->data, 2*x->data->cap+1);
+                    x->data->emplace(mem.alloc, pos, std::move(tmp));
+                } else {
+                    x->data->emplace(mem.alloc, pos, std::forward<Args>(args)...);
+                }
+            } catch (...) {
+                if (x->data->size == 0) freeBlock(x);
+                throw;
+            }
+        }
 
-        void update(list<block> *x) {
+        //Ask the policy for a new block size once size_c drifts by a quarter
+        void resize() {
+            if (size_c >= blo && size_c <= bhi) return;
+            bsize = BlockPolicy::size(size_c, sizeof(T));
+            if (bsize < 1) bsize = 1;
+            blo = size_c - size_c/4;
+            bhi = size_c + size_c/4 + 16;
+        }
+
+        //Lay the blocks out in the middle of dir, at least n/2 free slots each side
+        void rebuild() const {
+            int n = 0;
+            for (auto p = bs.next; p != &bs; p = p->next) n++;
+            if (dcap < 2*n+16 || dcap > 8*n+64) {
+                int ncap = 4*n+16;
+                list<block> **ndir = mem.template allocate_array<list<block> *>(ncap);
+                int *nfen;
+                try {
+                    nfen = mem.template allocate_array<int>(ncap+1);
+                } catch (...) {
+                    mem.deallocate_array(ndir, ncap);
+                    throw;
+                }
+                mem.deallocate_array(dir, dcap);
+                mem.deallocate_array(fen, dcap+1);
+                dir = ndir;
+                fen = nfen;
+                dcap = ncap;
+            }
+            dlo = dhi = (dcap - n)/2;
+            for (int i = 0; i < dcap; i++) {
+                dir[i] = nullptr;
+                fen[i+1] = 0;
+            }
+            for (auto p = bs.next; p != &bs; p = p->next) {
+                p->data->id = dhi;
+                p->data->fsize = p->data->size;
+                fen[dhi+1] = p->data->size;
+                dir[dhi++] = p;
+            }
+            for (int i = 1; i <= dcap; i++) {
+                int j = i + (i & -i);
+                if (j <= dcap) fen[j] += fen[i];
+            }
+            stale.store(false, std::memory_order_release);
+        }
+
+        //Rebuild the directory if it is stale, at most one thread at a time
+        void directory() const {
+            if (!stale.load(std::memory_order_acquire)) return;
+            while (building.exchange(true, std::memory_order_acquire)) std::this_thread::yield();
+            if (stale.load(std::memory_order_relaxed)) rebuild();
+            building.store(false, std::memory_order_release);
+        }
+
+        //Push the size change of block x into fen
+        void refresh(block *x) {
+            if (stale.load(std::memory_order_relaxed)) return;
+            for (int i = x->id+1, d = x->size - x->fsize; i <= dcap; i += i & -i) fen[i] += d;
+            x->fsize = x->size;
+        }
+
+        //Index of the first element of block x
+        int prefix(const block *x) const {
+            int sum = 0;
+            for (int i = x->id; i > 0; i -= i & -i) sum += fen[i];
+            return sum;
+        }
+
+        //Index of element pos of block x, size_c for the end
+        int index(const list<block> *x, int pos) const {
+            if (x == &bs) return size_c;
+            directory();
+            return prefix(x->data) + pos;
+        }
+
+        //Whether (x, pos) still names an element of this deque, or its end
+        bool valid(const list<block> *x, int pos) const {
+            if (x == &bs) return pos == 0;
+            directory();
+            int id = x->data->id;
+            return id >= dlo && id < dhi && dir[id] == x && pos < x->data->size;
+        }
+
+        //Block holding element idx, which becomes its offset there
+        list<block>* find(int &idx) const {
+            if (idx >= size_c) {
+                idx = 0;
+                return const_cast<list<block> *>(&bs);
+            }
+            directory();
+            int i = 0, step = 1;
+            for (; step*2 <= dcap; step *= 2);
+            for (; step; step /= 2) {
+                if (i+step <= dcap && fen[i+step] <= idx) {
+                    i += step;
+                    idx -= fen[i];
+                }
+            }
+            return dir[i];
+        }
+
+        //Carry the pending job on by up to n elements, (x, pos) moves along
+        void step(list<block> *&x, int &pos, int n) {
+            list<block> *src = work.src, *dst = work.dst;
+            if (!src) return;
+            block *s = src->data, *d = dst->data;
+            if (n > work.left) n = work.left;
+            if (n > s->size) n = s->size;
+            //plan() left room, unless inserts into d have used it up since
+            mem.reserve(d, d->size + n);
+            if (dst == src->next) {
+                for (int i = 0; i < n; i++) {
+                    d->emplace(mem.alloc, 0, std::move(s->at(s->size - 1)));
+                    s->pop_back(mem.alloc);
+                }
+                if (x == src && pos >= s->size) {
+                    x = dst;
+                    pos -= s->size;
+                } else if (x == dst) {
+                    pos += n;
+                }
+            } else {
+                for (int i = 0; i < n; i++) {
+                    d->emplace(mem.alloc, d->size, std::move(s->at(0)));
+                    s->pop_front(mem.alloc);
+                }
+                if (x == src) {
+                    if (pos < n) {
+                        x = dst;
+                        pos += d->size - n;
+                    } else {
+                        pos -= n;
+                    }
+                }
+            }
+            version++;
+            work.left -= n;
+            refresh(s);
+            refresh(d);
+            if (s->size == 0) {
+                if (x == src) {
+                    x = src->next;
+                    pos = 0;
+                }
+                freeBlock(src);
+            } else if (work.left == 0) {
+                work.src = work.dst = nullptr;
+            }
+        }
+
+        //Whether block d takes n more elements with a quarter of its buffer to spare
+        static bool room(const block *d, int n) {
+            return d->size + n <= d->cap - d->cap/4;
+        }
+
+        /**
+         * Start a job if block x left its size range and it has room to grow
+         * meanwhile. The destination of a split gets a buffer as large as
+         * x's while it is still empty, and a merge only goes to a neighbour
+         * with room already, so step() never has to grow a buffer full of
+         * elements.
+         */
+        void plan(list<block> *x) {
+            block *b = x->data;
+            if (b->size > 3*bsize/2 || !room(b, 0)) {
+                list<block> *y = x->prev == &bs ? makeBlock(x) : makeBlock(x->next);
+                try {
+                    mem.reserve(y->data, b->cap);
+                } catch (...) {
+                    freeBlock(y);
+                    throw;
+                }
+                work = job{x, y, b->size/2};
+            } else if (b->size < bsize/2) {
+                if (x->prev != &bs && x->prev->data->size + b->size <= bsize && room(x->prev->data, b->size)) {
+                    work = job{x, x->prev, b->size};
+                } else if (x->next != &bs && x->next->data->size + b->size <= bsize && room(b, x->next->data->size)) {
+                    work = job{x->next, x, x->next->data->size};
+                }
+            }
+        }
+
+        /**
+         * rebalance block x after its size changed.
+         * (x, pos) names an element of x (or the end of x) and is moved
+         * along with the element when blocks are split, merged or erased.
+         */
+        void update(list<block> *&x, int &pos) {
             if (x == &bs) return;
-            bsize = BSIZE*BSIZE < size_c ? sqrt(size_c) : BSIZE;
+            resize();
 
             if (x->data->size == 0) {
-                list<block>::erase(x);
+                x = x->next;
+                pos = 0;
+                freeBlock(x->prev);
                 return;
             }
 
-            //Split
-            if (x->data->size > 2*bsize) {
-                x->insert_after(makeBlock(x->data->cut_after(x->data->size/2)));
+            //A guard holds splits back, but a block taking every insert at
+            //one position would make each of them cost its whole size
+            if (batch && x->data->size > 4*bsize) {
+                int half = x->data->size/2;
+                list<block> *y = cut(x, half);
+                if (pos >= half) {
+                    x = y;
+                    pos -= half;
+                }
+            }
+
+            if (INCREMENTAL) {
+                if (!batch && !work.src) plan(x);
+                step(x, pos, STEP);
+                if (x == &bs) return;
             }
 
-            //Merge
-            if (x->data->size < bsize) {
-                if (x->prev != &bs && x->prev->data->size + x->data->size <= 2*bsize) {
-                    auto *tmp = x->data, *p = x->prev;
-                    x->data = nullptr;
-					list<block>::erase(x);
-                    p->data->link_after(tmp);
-                } else if (x->next!= &bs && x->next->data->size + x->data->size <= 2*bsize) {
-                    auto *tmp = x->next->data, *p = x;
-                    x->next->data = nullptr;
-					list<block>::erase(x->next);
-                    p->data->link_after(tmp);
+            //Split, the first block to the front so that the new block
+            //keeps its place in the directory at either end
+            if (!INCREMENTAL && !batch && x->data->size > 2*bsize) {
+                int half = x->data->size/2;
+                if (x->prev == &bs) {
+                    makeBlock(x);
+                    mem.reserve(x->prev->data, half);
+                    x->data->cut_before(mem.alloc, half, x->prev->data);
+                    refresh(x->data);
+                    refresh(x->prev->data);
+                    if (pos < half) {
+                        x = x->prev;
+                    } else {
+                        pos -= half;
+                    }
+                } else {
+                    makeBlock(x->next);
+                    mem.reserve(x->next->data, x->data->size - half);
+                    x->data->cut_after(mem.alloc, half, x->next->data);
+                    refresh(x->data);
+                    refresh(x->next->data);
+                    if (pos >= half) {
+                        x = x->next;
+                        pos -= half;
+                    }
+                }
+            }
+
+            //Merge, leaving bsize/2 of slack on both sides so that pushing and
+            //popping around a block boundary does not split and merge in turn
+            if (!INCREMENTAL && !batch && x->data->size < bsize/2) {
+                if (x->prev != &bs && x->prev->data->size + x->data->size <= 3*bsize/2) {
+                    auto *p = x->prev;
+                    pos += p->data->size;
+                    mem.reserve(p->data, p->data->size + x->data->size);
+                    p->data->link_after(mem.alloc, x->data);
+					freeBlock(x);
+                    x = p;
+                } else if (x->next!= &bs && x->next->data->size + x->data->size <= 3*bsize/2) {
+                    //Move the small block into the front of the next one, so
+                    //that prepending a few elements does not copy a whole block
+                    auto *n = x->next;
+                    mem.reserve(n->data, n->data->size + x->data->size);
+                    for (int i = x->data->size - 1; i >= 0; i--) {
+                        n->data->emplace(mem.alloc, 0, std::move(x->data->at(i)));
+                    }
+					freeBlock(x);
+                    x = n;
                 }
             }
+
+            refresh(x->data);
+            if (pos >= x->data->size) {
+                x = x->next;
+                pos = 0;
+            }
+        }
+
+        void update(list<block> *x) {
+            int pos = 0;
+            update(x, pos);
+        }
+
+        //Bring every block back to between bsize and 2*bsize in one pass
+        void rebalance() {
+            resize();
+            for (list<block> *x = bs.next; x != &bs; x = x->next) {
+                if (x->data->size == 0) {
+                    x = x->prev;
+                    freeBlock(x->next);
+                    continue;
+                }
+                //Split off bsize elements at a time from the back
+                while (x->data->size > 2*bsize) {
+                    cut(x, x->data->size - bsize);
+                }
+                while (x->data->size < bsize && x->next != &bs && x->data->size + x->next->data->size <= 2*bsize) {
+                    mem.reserve(x->data, x->data->size + x->next->data->size);
+                    x->data->link_after(mem.alloc, x->next->data);
+                    freeBlock(x->next);
+                }
+            }
+            stale.store(true, std::memory_order_relaxed);
+        }
+
+        //Split block x before element pos, return the block starting there
+        list<block>* cut(list<block> *x, int pos) {
+            work.src = work.dst = nullptr;
+            if (pos == 0) return x;
+            makeBlock(x->next);
+            mem.reserve(x->next->data, x->data->size - pos);
+            x->data->cut_after(mem.alloc, pos, x->next->data);
+            refresh(x->data);
+            refresh(x->next->data);
+            return x->next;
+        }
+
+        //Rebalance the blocks around a spliced range, right to left
+        void updateRange(list<block> *left, list<block> *last, list<block> *right) {
+            update(right);
+            if (last) update(last);
+            update(left);
+        }
+
+        //Whether iterator pos belongs to this deque and is still usable
+        template <class It>
+        bool owns(const It &pos) const {
+            return pos.from == this && (pos.ver == version || valid(pos.pb, pos.pos));
+        }
+
+        //Exchange the block rings hanging off sentinels a and b
+        static void swapRing(list<block> &a, list<block> &b) {
+            list<block> *an = a.next, *ap = a.prev, *bn = b.next, *bp = b.prev;
+            if (bn == &b) {
+                a.next = a.prev = &a;
+            } else {
+                a.next = bn;
+                a.prev = bp;
+                bn->prev = bp->next = &a;
+            }
+            if (an == &a) {
+                b.next = b.prev = &b;
+            } else {
+                b.next = an;
+                b.prev = ap;
+                an->prev = ap->next = &b;
+            }
+        }
+
+        //Free the directory arrays, the next lookup allocates them again
+        void dropDirectory() {
+            mem.deallocate_array(dir, dcap);
+            mem.deallocate_array(fen, dcap+1);
+            dir = nullptr;
+            fen = nullptr;
+            dlo = dhi = dcap = 0;
+            stale.store(true, std::memory_order_relaxed);
         }
 
         void copy(const deque &other) {
+            stale.store(true, std::memory_order_relaxed);
+            //Pick the block size for the final size, but count the elements
+            //as they come so a throwing copy leaves size_c right
             size_c = other.size_c;
-            bsize = sqrt(size_c);
-            int cnt = bsize;
-            for (auto it = other.cbegin(); it!=other.cend(); it++) {
-                if (cnt==bsize) {
-                    cnt = 0;
-                    bs.insert_before(makeBlock());
+            resize();
+            size_c = 0;
+            for (auto p = other.bs.next; p != &other.bs; p = p->next) {
+                for (int i = 0; i < p->data->size; i++) {
+                    if (bs.prev == &bs || bs.prev->data->size == bsize) {
+                        makeBlock(&bs);
+                    }
+                    bs.prev->data->push_back(mem.alloc, p->data->at(i));
+                    size_c++;
+                }
+            }
+        }
+
+        /**
+         * Call f(first, last, x, pos) on the contiguous pieces of the range
+         * from position pos of block x up to position end of block y, in
+         * order, where pos is the position of first within x. Stops early
+         * once f returns false.
+         */
+        template <class U, class Node, class F>
+        static void pieces(Node *x, int pos, Node *y, int end, F f) {
+            for (;; x = x->next, pos = 0) {
+                auto &b = *x->data;
+                int stop = x == y ? end : b.size;
+                if (pos < stop) {
+                    U *buf = b.buf, *p = buf + b.slot(pos);
+                    int len = stop - pos, n = b.cap - b.slot(pos);
+                    if (n > len) n = len;
+                    if (!f(p, p + n, x, pos)) return;
+                    if (n < len && !f(buf, buf + (len - n), x, pos + n)) return;
                 }
-                bs.prev->data->push_back(*it);
-                cnt++;
+                if (x == y) return;
             }
         }
 
@@ -253,64 +1003,60 @@ namespace sjtu {
         class const_iterator;
         class iterator {
             friend class deque;
+            friend class const_iterator;
         private:
             /**
              * add data members.
              * just add whatever you want.
              */
-            deque<T> *from;
-			list<T> *p;
-            int cur;
-
-            iterator(deque<T> *from, list<T> *p, int cur=0) : from(from), p(p), cur(cur) {}
+            deque *from;
+			list<block> *pb;
+            int pos;
+            unsigned ver;
 
-			list<block>* findBlock() const {
-				list<T> *p1 = p;
-				for (; !nfrom(p1); p1 = p1->prev);
-				return nfrom(p1);
-			}
+            iterator(deque *from, list<block> *pb, int pos, unsigned ver) : from(from), pb(pb), pos(pos), ver(ver) {}
 
         public:
-            iterator() : from(nullptr), p(nullptr), cur(0) {}
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef T value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef T *pointer;
+            typedef T &reference;
+
+            iterator() : from(nullptr), pb(nullptr), pos(0), ver(0) {}
 
             /**
              * return a new iterator which points to the n-next element.
              * if there are not enough elements, the behaviour is undefined.
              * same for operator-.
              */
-            iterator operator+(const int &n) const {
+            iterator operator+(const difference_type &n) const {
                 if (n<0) return *this - (-n);
-                if (cur+n >= from->size_c) {
-                    throw index_out_of_bound();
+                if (pos+n < pb->data->size) return iterator(from, pb, pos+n, ver);
+                if (pb != &from->bs && pos+n-pb->data->size < pb->next->data->size) {
+                    return iterator(from, pb->next, pos+n-pb->data->size, ver);
                 }
-				list<T> *p1 = p;
-				int nn = n;
-
-                //Special for begin() + n
-                if (nfrom(p1->prev) && nn >= nfrom(p1->prev)->data->size) {
-                    nn-=nfrom(p1->prev)->data->size;
-                    p1 = p1->prev;
-                } else {
-                    for (; nn && !nfrom(p1); p1 = p1->next, nn--)
-                        ;
-                    if (!nfrom(p1)) return iterator(from, p1, cur+n);
+                difference_type to = from->index(pb, pos) + n;
+                if (to > from->size_c) {
+                    throw index_out_of_bound();
                 }
-                list<block> *pb = nfrom(p1)->next;
-				for (; nn>=pb->data->size; nn -= pb->data->size, pb = pb->next);
-				return iterator(from, pb->data->head.next->next_nth(nn), cur+n);
+                int idx = to;
+                auto *p1 = from->find(idx);
+				return iterator(from, p1, idx, from->version);
             }
-            iterator operator-(const int &n) const {
+            iterator operator-(const difference_type &n) const {
                 if (n<0) return *this + (-n);
-                if (cur-n < 0) {
+                if (n <= pos) return iterator(from, pb, pos-n, ver);
+                if (n-pos <= pb->prev->data->size) {
+                    return iterator(from, pb->prev, pb->prev->data->size-(n-pos), ver);
+                }
+                difference_type to = from->index(pb, pos) - n;
+                if (to < 0) {
                     throw index_out_of_bound();
                 }
-				list<T> *p1 = p;
-				int ncur = cur, nn = n;
-				for (; nn && !nfrom(p1); p1 = p1->prev, nn--, ncur--);
-				if (!nfrom(p1)) return iterator(from, p1, ncur);
-				list<block> *pb = nfrom(p1)->prev;
-				for (; nn>=pb->data->size; nn -= pb->data->size, ncur -= pb->data->size, pb = pb->prev);
-				return iterator(from, pb->data->head.prev->prev_nth(nn), ncur-nn);
+                int idx = to;
+                auto *p1 = from->find(idx);
+				return iterator(from, p1, idx, from->version);
             }
 
             /**
@@ -318,16 +1064,19 @@ namespace sjtu {
              * if they point to different vectors, throw
              * invaild_iterator.
              */
-            int operator-(const iterator &rhs) const {
+            difference_type operator-(const iterator &rhs) const {
                 if (from != rhs.from) {
                     throw invalid_iterator();
                 }
-				return cur-rhs.cur;
+				return from->index(pb, pos) - from->index(rhs.pb, rhs.pos);
+            }
+            difference_type operator-(const const_iterator &rhs) const {
+                return const_iterator(*this) - rhs;
             }
-            iterator &operator+=(const int &n) {
+            iterator &operator+=(const difference_type &n) {
                 return *this = *this + n;
             }
-            iterator &operator-=(const int &n) {
+            iterator &operator-=(const difference_type &n) {
                 return *this = *this - n;
             }
 
@@ -343,7 +1092,16 @@ namespace sjtu {
              * ++iter
              */
             iterator &operator++() {
-                return *this = *this + 1;
+                if (pos+1 < pb->data->size) {
+                    ++pos;
+                    return *this;
+                }
+                if (pb == &from->bs) {
+                    throw index_out_of_bound();
+                }
+                pb = pb->next;
+                pos = 0;
+                return *this;
             }
             /**
              * iter--
@@ -357,26 +1115,41 @@ namespace sjtu {
              * --iter
              */
             iterator &operator--() {
-                return *this = *this - 1;
+                if (pos) {
+                    --pos;
+                    return *this;
+                }
+                if (pb->prev == &from->bs) {
+                    throw index_out_of_bound();
+                }
+                pb = pb->prev;
+                pos = pb->data->size-1;
+                return *this;
             }
 
             /**
              * *it
              */
             T &operator*() const {
-                if (!p->data) {
+                if (pos >= pb->data->size) {
                     throw invalid_iterator();
                 }
-                return *p->data;
+                return pb->data->at(pos);
             }
             /**
              * it->field
              */
-            T *operator->() const noexcept {
-                if (!p->data) {
+            T *operator->() const {
+                if (pos >= pb->data->size) {
                     throw invalid_iterator();
                 }
-                return p->data;
+                return &pb->data->at(pos);
+            }
+            /**
+             * it[n], the same as *(it + n)
+             */
+            T &operator[](const difference_type &n) const {
+                return *(*this + n);
             }
 
             /**
@@ -384,10 +1157,10 @@ namespace sjtu {
              * memory).
              */
             bool operator==(const iterator &rhs) const {
-				return p == rhs.p;
+				return pb == rhs.pb && pos == rhs.pos;
             }
             bool operator==(const const_iterator &rhs) const {
-				return p == rhs.p;
+				return pb == rhs.pb && pos == rhs.pos;
             }
             /**
              * some other operator for iterators.
@@ -398,10 +1171,88 @@ namespace sjtu {
             bool operator!=(const const_iterator &rhs) const {
                 return !(*this == rhs);
             }
+            /**
+             * order by position; comparing iterators of different deques
+             * throws invalid_iterator.
+             */
+            bool operator<(const iterator &rhs) const {
+                return before(rhs.from, rhs.pb, rhs.pos);
+            }
+            bool operator<(const const_iterator &rhs) const {
+                return before(rhs.from, rhs.pb, rhs.pos);
+            }
+            bool operator>(const iterator &rhs) const {
+                return rhs < *this;
+            }
+            bool operator>(const const_iterator &rhs) const {
+                return rhs < *this;
+            }
+            bool operator<=(const iterator &rhs) const {
+                return !(rhs < *this);
+            }
+            bool operator<=(const const_iterator &rhs) const {
+                return !(rhs < *this);
+            }
+            bool operator>=(const iterator &rhs) const {
+                return !(*this < rhs);
+            }
+            bool operator>=(const const_iterator &rhs) const {
+                return !(*this < rhs);
+            }
+            friend iterator operator+(const difference_type &n, const iterator &it) {
+                return it + n;
+            }
+
+            /**
+             * Block-wise std::copy, std::fill and std::find for ranges of
+             * this deque, found by argument-dependent lookup: after
+             * using std::copy; an unqualified copy(first, last, out) picks
+             * these over the element-by-element std versions.
+             */
+            template <class OutputIt>
+            friend OutputIt copy(iterator first, iterator last, OutputIt out) {
+                first.walk(last, [&](T *p, T *q, list<block> *, int) {
+                    out = std::copy(p, q, out);
+                    return true;
+                });
+                return out;
+            }
+            template <class V>
+            friend void fill(iterator first, iterator last, const V &value) {
+                first.walk(last, [&](T *p, T *q, list<block> *, int) {
+                    std::fill(p, q, value);
+                    return true;
+                });
+            }
+            template <class V>
+            friend iterator find(iterator first, iterator last, const V &value) {
+                iterator res = last;
+                first.walk(last, [&](T *p, T *q, list<block> *x, int pos) {
+                    T *r = std::find(p, q, value);
+                    if (r == q) return true;
+                    res = iterator(first.from, x, pos + (int)(r - p), first.ver);
+                    return false;
+                });
+                return res;
+            }
+        private:
+            //deque::pieces over [*this, last)
+            template <class F>
+            void walk(const iterator &last, F f) const {
+                deque::pieces<T>(pb, pos, last.pb, last.pos, f);
+            }
+            bool before(const deque *rf, const list<block> *rpb, int rpos) const {
+                if (from != rf) {
+                    throw invalid_iterator();
+                }
+                if (pb == rpb) return pos < rpos;
+                return from->index(pb, pos) < from->index(rpb, rpos);
+            }
         };
 
         class const_iterator {
             friend class deque;
+            friend class iterator;
             /**
              * it should has similar member method as iterator.
              * you can copy them, but with care!
@@ -415,59 +1266,55 @@ namespace sjtu {
              * add data members.
              * just add whatever you want.
              */
-            const deque<T> *from;
-			const list<T> *p;
-            int cur;
+            const deque *from;
+			const list<block> *pb;
+            int pos;
+            unsigned ver;
 
-            const_iterator(const deque<T> *from, const list<T> *p, int cur=0) : from(from), p(p), cur(cur) {}
+            const_iterator(const deque *from, const list<block> *pb, int pos, unsigned ver) : from(from), pb(pb), pos(pos), ver(ver) {}
 
-			list<block>* findBlock() const {
-				auto p1 = p;
-				for (; !nfrom(p1); p1 = p1->prev);
-				return nfrom(p1);
-			}
         public:
-            const_iterator() : from(nullptr), p(nullptr), cur(0) {}
-			const_iterator(const iterator &other) : from(other.from), p(other.p), cur(other.cur) {}
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef T value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const T *pointer;
+            typedef const T &reference;
+
+            const_iterator() : from(nullptr), pb(nullptr), pos(0), ver(0) {}
+			const_iterator(const iterator &other) : from(other.from), pb(other.pb), pos(other.pos), ver(other.ver) {}
 
             /**
              * return a new iterator which points to the n-next element.
              * if there are not enough elements, the behaviour is undefined.
              * same for operator-.
              */
-            const_iterator operator+(const int &n) const {
+            const_iterator operator+(const difference_type &n) const {
                 if (n<0) return *this - (-n);
-                if (cur+n >= from->size_c) {
-                    throw index_out_of_bound();
+                if (pos+n < pb->data->size) return const_iterator(from, pb, pos+n, ver);
+                if (pb != &from->bs && pos+n-pb->data->size < pb->next->data->size) {
+                    return const_iterator(from, pb->next, pos+n-pb->data->size, ver);
                 }
-				auto *p1 = p;
-				int nn = n;
-
-                //Special for begin() + n
-                if (nfrom(p1->prev) && nn >= nfrom(p1->prev)->data->size) {
-                    nn-=nfrom(p1->prev)->data->size;
-                    p1 = p1->prev;
-                } else {
-                    for (; nn && !nfrom(p1); p1 = p1->next, nn--)
-                        ;
-                    if (!nfrom(p1)) return const_iterator(from, p1, cur+n);
+                difference_type to = from->index(pb, pos) + n;
+                if (to > from->size_c) {
+                    throw index_out_of_bound();
                 }
-                list<block> *pb = nfrom(p1)->next;
-				for (; nn>=pb->data->size; nn -= pb->data->size, pb = pb->next);
-				return const_iterator(from, pb->data->head.next->next_nth(nn), cur+n);
+                int idx = to;
+                auto *p1 = from->find(idx);
+				return const_iterator(from, p1, idx, from->version);
             }
-            const_iterator operator-(const int &n) const {
+            const_iterator operator-(const difference_type &n) const {
                 if (n<0) return *this + (-n);
-                if (cur-n < 0) {
+                if (n <= pos) return const_iterator(from, pb, pos-n, ver);
+                if (n-pos <= pb->prev->data->size) {
+                    return const_iterator(from, pb->prev, pb->prev->data->size-(n-pos), ver);
+                }
+                difference_type to = from->index(pb, pos) - n;
+                if (to < 0) {
                     throw index_out_of_bound();
                 }
-				auto *p1 = p;
-				int ncur = cur, nn = n;
-				for (; nn && !nfrom(p1); p1 = p1->prev, nn--, ncur--);
-				if (!nfrom(p1)) return const_iterator(from, p1, ncur);
-				list<block> *pb = nfrom(p1)->prev;
-				for (; nn>=pb->data->size; nn -= pb->data->size, ncur -= pb->data->size, pb = pb->prev);
-				return const_iterator(from, pb->data->head.prev->prev_nth(nn), ncur-nn);
+                int idx = to;
+                auto *p1 = from->find(idx);
+				return const_iterator(from, p1, idx, from->version);
             }
 
             /**
@@ -475,16 +1322,19 @@ namespace sjtu {
              * if they point to different vectors, throw
              * invaild_iterator.
              */
-            int operator-(const const_iterator &rhs) const {
+            difference_type operator-(const const_iterator &rhs) const {
                 if (from != rhs.from) {
                     throw invalid_iterator();
                 }
-				return cur-rhs.cur;
+				return from->index(pb, pos) - from->index(rhs.pb, rhs.pos);
             }
-            const_iterator &operator+=(const int &n) {
+            difference_type operator-(const iterator &rhs) const {
+                return *this - const_iterator(rhs);
+            }
+            const_iterator &operator+=(const difference_type &n) {
                 return *this = *this + n;
             }
-            const_iterator &operator-=(const int &n) {
+            const_iterator &operator-=(const difference_type &n) {
                 return *this = *this - n;
             }
 
@@ -500,7 +1350,16 @@ namespace sjtu {
              * ++iter
              */
             const_iterator &operator++() {
-                return *this = *this + 1;
+                if (pos+1 < pb->data->size) {
+                    ++pos;
+                    return *this;
+                }
+                if (pb == &from->bs) {
+                    throw index_out_of_bound();
+                }
+                pb = pb->next;
+                pos = 0;
+                return *this;
             }
             /**
              * iter--
@@ -514,26 +1373,41 @@ namespace sjtu {
              * --iter
              */
             const_iterator &operator--() {
-                return *this = *this - 1;
+                if (pos) {
+                    --pos;
+                    return *this;
+                }
+                if (pb->prev == &from->bs) {
+                    throw index_out_of_bound();
+                }
+                pb = pb->prev;
+                pos = pb->data->size-1;
+                return *this;
             }
 
             /**
              * *it
              */
-            T &operator*() const {
-                if (!p->data) {
+            const T &operator*() const {
+                if (pos >= pb->data->size) {
                     throw invalid_iterator();
                 }
-                return *p->data;
+                return pb->data->at(pos);
             }
             /**
              * it->field
              */
-            T *operator->() const noexcept {
-                if (!p->data) {
+            const T *operator->() const {
+                if (pos >= pb->data->size) {
                     throw invalid_iterator();
                 }
-                return p->data;
+                return &pb->data->at(pos);
+            }
+            /**
+             * it[n], the same as *(it + n)
+             */
+            const T &operator[](const difference_type &n) const {
+                return *(*this + n);
             }
 
             /**
@@ -541,10 +1415,10 @@ namespace sjtu {
              * memory).
              */
             bool operator==(const iterator &rhs) const {
-				return p == rhs.p;
+				return pb == rhs.pb && pos == rhs.pos;
             }
             bool operator==(const const_iterator &rhs) const {
-				return p == rhs.p;
+				return pb == rhs.pb && pos == rhs.pos;
             }
             /**
              * some other operator for iterators.
@@ -555,57 +1429,338 @@ namespace sjtu {
             bool operator!=(const const_iterator &rhs) const {
                 return !(*this == rhs);
             }
+            /**
+             * order by position; comparing iterators of different deques
+             * throws invalid_iterator.
+             */
+            bool operator<(const iterator &rhs) const {
+                return before(rhs.from, rhs.pb, rhs.pos);
+            }
+            bool operator<(const const_iterator &rhs) const {
+                return before(rhs.from, rhs.pb, rhs.pos);
+            }
+            bool operator>(const iterator &rhs) const {
+                return rhs < *this;
+            }
+            bool operator>(const const_iterator &rhs) const {
+                return rhs < *this;
+            }
+            bool operator<=(const iterator &rhs) const {
+                return !(rhs < *this);
+            }
+            bool operator<=(const const_iterator &rhs) const {
+                return !(rhs < *this);
+            }
+            bool operator>=(const iterator &rhs) const {
+                return !(*this < rhs);
+            }
+            bool operator>=(const const_iterator &rhs) const {
+                return !(*this < rhs);
+            }
+            friend const_iterator operator+(const difference_type &n, const const_iterator &it) {
+                return it + n;
+            }
+
+            /**
+             * Block-wise std::copy, std::fill and std::find for ranges of
+             * this deque, found by argument-dependent lookup: after
+             * using std::copy; an unqualified copy(first, last, out) picks
+             * these over the element-by-element std versions.
+             */
+            template <class OutputIt>
+            friend OutputIt copy(const_iterator first, const_iterator last, OutputIt out) {
+                first.walk(last, [&](const T *p, const T *q, const list<block> *, int) {
+                    out = std::copy(p, q, out);
+                    return true;
+                });
+                return out;
+            }
+            template <class V>
+            friend const_iterator find(const_iterator first, const_iterator last, const V &value) {
+                const_iterator res = last;
+                first.walk(last, [&](const T *p, const T *q, const list<block> *x, int pos) {
+                    const T *r = std::find(p, q, value);
+                    if (r == q) return true;
+                    res = const_iterator(first.from, x, pos + (int)(r - p), first.ver);
+                    return false;
+                });
+                return res;
+            }
+        private:
+            //deque::pieces over [*this, last)
+            template <class F>
+            void walk(const const_iterator &last, F f) const {
+                deque::pieces<const T>(pb, pos, last.pb, last.pos, f);
+            }
+            bool before(const deque *rf, const list<block> *rpb, int rpos) const {
+                if (from != rf) {
+                    throw invalid_iterator();
+                }
+                if (pb == rpb) return pos < rpos;
+                return from->index(pb, pos) < from->index(rpb, rpos);
+            }
+        };
+
+        typedef std::reverse_iterator<iterator> reverse_iterator;
+        typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+        typedef T value_type;
+        typedef T &reference;
+        typedef const T &const_reference;
+        typedef size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef Allocator allocator_type;
+
+        /**
+         * A run of elements lying contiguously in memory, [first, last).
+         */
+        template <class U>
+        struct basic_segment {
+            U *first, *last;
+
+            U *begin() const {
+                return first;
+            }
+            U *end() const {
+                return last;
+            }
+            size_t size() const {
+                return last - first;
+            }
+        };
+        typedef basic_segment<T> segment;
+        typedef basic_segment<const T> const_segment;
+
+        /**
+         * The elements as a sequence of contiguous segments, in order.
+         * A block gives one segment, or two when its circular buffer wraps
+         * around the end of the allocation.
+         */
+        template <class U, class Node>
+        class segment_range {
+        private:
+            Node *head;
+
+        public:
+            class iterator {
+            private:
+                Node *x;
+                bool wrapped;  //at the part of x's block past the buffer end
+
+            public:
+                iterator(Node *x) : x(x), wrapped(false) {}
+
+                basic_segment<U> operator*() const {
+                    const block &b = *x->data;
+                    int tail = b.cap - b.beg;
+                    if (wrapped) return basic_segment<U>{b.buf, b.buf + (b.size - tail)};
+                    return basic_segment<U>{b.buf + b.beg, b.buf + b.beg + (b.size < tail ? b.size : tail)};
+                }
+                //Whether this segment begins a block, not its wrapped part
+                bool starts_block() const {
+                    return !wrapped;
+                }
+                iterator &operator++() {
+                    if (!wrapped && x->data->beg + x->data->size > x->data->cap) {
+                        wrapped = true;
+                    } else {
+                        x = x->next;
+                        wrapped = false;
+                    }
+                    return *this;
+                }
+                bool operator==(const iterator &rhs) const {
+                    return x == rhs.x && wrapped == rhs.wrapped;
+                }
+                bool operator!=(const iterator &rhs) const {
+                    return !(*this == rhs);
+                }
+            };
+
+            segment_range(Node *head) : head(head) {}
+
+            iterator begin() const {
+                return iterator(head->next);
+            }
+            iterator end() const {
+                return iterator(head);
+            }
+        };
+
+        segment_range<T, list<block>> segments() {
+            return segment_range<T, list<block>>(&bs);
+        }
+        segment_range<const T, const list<block>> segments() const {
+            return segment_range<const T, const list<block>>(&bs);
+        }
+
+        /**
+         * While a batch_guard is alive, operations on the deque no longer
+         * merge blocks on the spot, blocks simply grow or shrink. A block is
+         * only split once it holds four times the block size, so that
+         * inserts at one position stay cheap. When the last guard goes away
+         * all blocks are rebalanced in a single pass. Guards may nest.
+         */
+        class batch_guard {
+        private:
+            deque &d;
+
+        public:
+            explicit batch_guard(deque &d) : d(d) {
+                d.batch++;
+            }
+            //If rebalancing runs out of memory the blocks are left as they
+            //are, unbalanced but valid, rather than throwing from here
+            ~batch_guard() {
+                if (--d.batch) return;
+                try {
+                    d.rebalance();
+                } catch (...) {
+                }
+            }
+            batch_guard(const batch_guard &) = delete;
+            batch_guard &operator=(const batch_guard &) = delete;
         };
 
         /**
          * constructors.
          */
-        deque() : size_c(1) {
-            bs.data = new block();
-            bs.data->head.insert_after(new node());
-			assignBlock(&bs);
-            bs.data->size=1;
+        deque() : bs(typename list<block>::inplace()), mem(Allocator()), size_c(0), bsize(BlockPolicy::size(0, sizeof(T))), blo(0), bhi(0), dir(nullptr), fen(nullptr), dlo(0), dhi(0), dcap(0), stale(true), version(0), batch(0) {}
+        explicit deque(const Allocator &alloc) : bs(typename list<block>::inplace()), mem(alloc), size_c(0), bsize(BlockPolicy::size(0, sizeof(T))), blo(0), bhi(0), dir(nullptr), fen(nullptr), dlo(0), dhi(0), dcap(0), stale(true), version(0), batch(0) {}
+        deque(const deque &other)
+            : bs(typename list<block>::inplace()),
+              mem(std::allocator_traits<Allocator>::select_on_container_copy_construction(other.mem.alloc)),
+              size_c(0), bsize(BlockPolicy::size(0, sizeof(T))), blo(0), bhi(0), dir(nullptr), fen(nullptr), dlo(0), dhi(0), dcap(0), stale(true), version(0), batch(0) {
+            //No destructor runs if this throws, hand the blocks copied so far
+            //back to mem before it goes away
+            try {
+                copy(other);
+            } catch (...) {
+                clear();
+                throw;
+            }
         }
-        deque(const deque &other) : size_c(1) {
-            bs.data = new block();
-            bs.data->head.insert_after(new node());
-			assignBlock(&bs);
-            bs.data->size=1;
-            copy(other);
+        deque(deque &&other) noexcept
+            : bs(typename list<block>::inplace()), mem(other.mem.alloc),
+              size_c(0), bsize(BlockPolicy::size(0, sizeof(T))), blo(0), bhi(0), dir(nullptr), fen(nullptr), dlo(0), dhi(0), dcap(0), stale(true), version(0), batch(0) {
+            exchange(other);
         }
 
         /**
          * deconstructor.
          */
-        ~deque() {}
+        ~deque() {
+            //The nodes of bs live in mem's chunks and must go back through
+            //mem, which is destroyed before bs
+            clear();
+        }
 
         /**
          * assignment operator.
          */
         deque &operator=(const deque &other) {
             if (&other == this) return *this;
-            clear();
-            copy(other);
+            //Copy aside first, so a throwing copy leaves this deque as it was
+            deque tmp(mem.alloc);
+            tmp.copy(other);
+            exchange(tmp);
+            return *this;
+        }
+        deque &operator=(deque &&other) noexcept(MOVE_STEALS) {
+            if (&other == this) return *this;
+            moveAssign(other, std::integral_constant<bool, MOVE_STEALS>());
             return *this;
         }
 
+        /**
+         * exchange the contents of two deques in O(1).
+         * iterators into either deque are invalidated.
+         * The allocators are exchanged only if the allocator propagates on
+         * swap, as with the standard containers the allocators must then
+         * compare equal.
+         */
+        void swap(deque &other) noexcept {
+            exchange(other);
+            swapAllocator(other, typename alloc_traits::propagate_on_container_swap());
+        }
+
+    private:
+        typedef std::allocator_traits<Allocator> alloc_traits;
+
+        //Move assignment can always take over the blocks of the other deque
+        static const bool MOVE_STEALS = alloc_traits::propagate_on_container_move_assignment::value || alloc_traits::is_always_equal::value;
+
+        void swapAllocator(deque &other, std::true_type) noexcept {
+            using std::swap;
+            swap(mem.alloc, other.mem.alloc);
+        }
+        void swapAllocator(deque &, std::false_type) noexcept {}
+
+        void moveAllocator(deque &other, std::true_type) noexcept {
+            mem.alloc = std::move(other.mem.alloc);
+        }
+        void moveAllocator(deque &, std::false_type) noexcept {}
+
+        void moveAssign(deque &other, std::true_type) noexcept {
+            clear();
+            moveAllocator(other, typename alloc_traits::propagate_on_container_move_assignment());
+            exchange(other);
+        }
+        //Allocators that may differ: take the blocks if they are equal, else move element by element
+        void moveAssign(deque &other, std::false_type) {
+            clear();
+            if (mem.alloc == other.mem.alloc) {
+                exchange(other);
+                return;
+            }
+            {
+                batch_guard guard(*this);
+                for (auto seg : other.segments()) {
+                    for (T *p = seg.first; p != seg.last; ++p) emplace_back(std::move(*p));
+                }
+            }
+            other.clear();
+        }
+
+        //Exchange everything but the allocators
+        void exchange(deque &other) noexcept {
+            swapRing(bs, other.bs);
+            mem.swap(other.mem);
+            std::swap(size_c, other.size_c);
+            std::swap(bsize, other.bsize);
+            std::swap(blo, other.blo);
+            std::swap(bhi, other.bhi);
+            std::swap(dir, other.dir);
+            std::swap(fen, other.fen);
+            std::swap(dlo, other.dlo);
+            std::swap(dhi, other.dhi);
+            std::swap(dcap, other.dcap);
+            bool st = stale.load(std::memory_order_relaxed);
+            stale.store(other.stale.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            other.stale.store(st, std::memory_order_relaxed);
+            std::swap(work, other.work);
+            version++;
+            other.version++;
+        }
+
+    public:
+
         /**
          * access a specified element with bound checking.
          * throw index_out_of_bound if out of bound.
          */
         T &at(const size_t &pos) {
-            if (pos >= size_c-1) {
+            if (pos >= (size_t)size_c) {
                 throw index_out_of_bound();
             }
-            iterator it = begin() + pos;
-            return *it;
+            int off = pos;
+            return find(off)->data->at(off);
         }
         const T &at(const size_t &pos) const {
-            if (pos >= size_c-1) {
+            if (pos >= (size_t)size_c) {
                 throw index_out_of_bound();
             }
-            const_iterator it = cbegin() + pos;
-            return *it;
+            int off = pos;
+            return find(off)->data->at(off);
         }
         T &operator[](const size_t &pos) {
             return at(pos);
@@ -633,42 +1788,94 @@ namespace sjtu {
          * return an iterator to the beginning.
          */
         iterator begin() {
-            return iterator(this, bs.next->data->head.next, 0);
+            return iterator(this, bs.next, 0, version);
+        }
+        const_iterator begin() const {
+            return cbegin();
         }
         const_iterator cbegin() const {
-            return const_iterator(this, bs.next->data->head.next, 0);
+            return const_iterator(this, bs.next, 0, version);
         }
 
         /**
          * return an iterator to the end.
          */
         iterator end() {
-            return iterator(this, bs.data->head.next, size_c-1);
+            return iterator(this, &bs, 0, version);
+        }
+        const_iterator end() const {
+            return cend();
         }
         const_iterator cend() const {
-            return const_iterator(this, bs.data->head.next, size_c-1);
+            return const_iterator(this, &bs, 0, version);
+        }
+
+        /**
+         * reverse iterators, walking from the last element to the first.
+         */
+        reverse_iterator rbegin() {
+            return reverse_iterator(end());
+        }
+        const_reverse_iterator rbegin() const {
+            return crbegin();
+        }
+        const_reverse_iterator crbegin() const {
+            return const_reverse_iterator(cend());
+        }
+        reverse_iterator rend() {
+            return reverse_iterator(begin());
+        }
+        const_reverse_iterator rend() const {
+            return crend();
+        }
+        const_reverse_iterator crend() const {
+            return const_reverse_iterator(cbegin());
         }
 
         /**
          * check whether the container is empty.
          */
         bool empty() const {
-            return size_c == 1;
+            return size_c == 0;
         }
 
         /**
          * return the number of elements.
          */
         size_t size() const {
-            return size_c-1;
+            return size_c;
         }
 
         /**
          * clear all contents.
          */
         void clear() {
-            for (; bs.next != &bs; list<block>::erase(bs.next));
-            size_c = 1;
+            work.src = work.dst = nullptr;
+            for (list<block> *x = bs.next; x != &bs; ) {
+                list<block> *next = x->next;
+                mem.destroy(x);
+                x = next;
+            }
+            bs.next = bs.prev = &bs;
+            version++;
+            dropDirectory();
+            mem.release();
+            size_c = 0;
+        }
+
+        Allocator get_allocator() const {
+            return mem.alloc;
+        }
+
+        /**
+         * number of requests made to and returned to the global allocator
+         * so far, for checking that steady-state operation is allocation-free.
+         */
+        size_t allocations() const {
+            return mem.allocs;
+        }
+        size_t deallocations() const {
+            return mem.frees;
         }
 
         /**
@@ -677,21 +1884,180 @@ namespace sjtu {
          * throw if the iterator is invalid or it points to a wrong place.
          */
         iterator insert(iterator pos, const T &value) {
-            if (pos.from!=this) {
+            return emplace(pos, value);
+        }
+        iterator insert(iterator pos, T &&value) {
+            return emplace(pos, std::move(value));
+        }
+
+        /**
+         * insert count copies of value, or the elements of [first, last),
+         * before pos. The new elements are packed into fresh blocks linked
+         * in whole, only the blocks at both ends of the run are rebalanced.
+         * return an iterator pointing to the first inserted element.
+         */
+        iterator insert(iterator pos, int count, const T &value) {
+            if (!owns(pos)) {
+                throw invalid_iterator();
+            }
+            if (count <= 0) return pos;
+            //value may be an element that cut() is about to move away
+            T v(value);
+            int idx = index(pos.pb, pos.pos);
+            list<block> *right = cut(pos.pb, pos.pos), *left = right->prev, *last = nullptr;
+            for (; count > 0; count--) {
+                if (!last || last->data->size >= bsize) {
+                    if (last) refresh(last->data);
+                    resize();
+                    last = makeBlock(right);
+                }
+                place(last, last->data->size, v);
+                size_c++;
+            }
+            updateRange(left, last, right);
+            list<block> *x = find(idx);
+            return iterator(this, x, idx, version);
+        }
+
+        template <class InputIt, class = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+        iterator insert(iterator pos, InputIt first, InputIt last) {
+            if (!owns(pos)) {
+                throw invalid_iterator();
+            }
+            int idx = index(pos.pb, pos.pos);
+            list<block> *right = cut(pos.pb, pos.pos), *left = right->prev, *tail = nullptr;
+            for (; first != last; ++first) {
+                if (!tail || tail->data->size >= bsize) {
+                    if (tail) refresh(tail->data);
+                    resize();
+                    tail = makeBlock(right);
+                }
+                place(tail, tail->data->size, *first);
+                size_c++;
+            }
+            updateRange(left, tail, right);
+            list<block> *x = find(idx);
+            return iterator(this, x, idx, version);
+        }
+
+        /**
+         * move every element of other before pos, other is left empty.
+         * the blocks of other are relinked rather than copied and only the
+         * block at pos is cut. append() and prepend() cost no more than
+         * rebalancing the blocks at the seam, O(bsize); splice() also looks
+         * up the returned iterator, which may rebuild the directory.
+         * elements are moved one by one if the allocators differ.
+         * return an iterator pointing to the first element taken from other.
+         */
+        iterator splice(iterator pos, deque &&other) {
+            if (!owns(pos) || &other == this) {
+                throw invalid_iterator();
+            }
+            int idx = index(pos.pb, pos.pos);
+            link(pos, std::move(other));
+            list<block> *x = find(idx);
+            return iterator(this, x, idx, version);
+        }
+        //As splice at the ends, without looking up the returned iterator
+        void append(deque &&other) {
+            if (&other == this) {
                 throw invalid_iterator();
             }
-			auto p1 = pos.findBlock(), p = pos.p;
+            link(end(), std::move(other));
+        }
+        void prepend(deque &&other) {
+            if (&other == this) {
+                throw invalid_iterator();
+            }
+            link(begin(), std::move(other));
+        }
+
+    private:
+        //splice without the returned iterator, pos is known to be ours
+        void link(iterator pos, deque &&other) {
+            if (!(mem.alloc == other.mem.alloc)) {
+                deque tmp(mem.alloc);
+                for (iterator it = other.begin(); it != other.end(); ++it) {
+                    tmp.emplace_back(std::move(*it));
+                }
+                other.clear();
+                link(pos, std::move(tmp));
+                return;
+            }
+            if (other.empty()) return;
+            list<block> *right = cut(pos.pb, pos.pos), *left = right->prev;
+            list<block> *first = other.bs.next, *last = other.bs.prev;
+            left->next = first;
+            first->prev = left;
+            last->next = right;
+            right->prev = last;
+            other.bs.next = other.bs.prev = &other.bs;
+            size_c += other.size_c;
+            other.size_c = 0;
+            other.work.src = other.work.dst = nullptr;
+            other.dropDirectory();
+            other.version++;
+            mem.adopt(other.mem);
+            stale.store(true, std::memory_order_relaxed);
+            version++;
+            update(right);
+            update(last);
+            if (first != last) update(first);
+            update(left);
+        }
+
+    public:
+
+        /**
+         * cut the deque before pos and return the elements from pos on as a
+         * new deque. only the block at pos is split, the blocks after it
+         * change owner whole, so no element is copied or moved.
+         * iterators into the returned part are invalidated.
+         */
+        deque split(iterator pos) {
+            if (!owns(pos)) {
+                throw invalid_iterator();
+            }
+            deque tail(mem.alloc);
+            int idx = index(pos.pb, pos.pos);
+            list<block> *x = cut(pos.pb, pos.pos), *left = x->prev;
+            work.src = work.dst = nullptr;
+            while (x != &bs) {
+                list<block> *next = x->next;
+                tail.bs.insert_before(mem.transfer(list<block>::detach(x), tail.mem));
+                x = next;
+            }
+            tail.size_c = size_c - idx;
+            size_c = idx;
+            stale.store(true, std::memory_order_relaxed);
+            version++;
+            update(left);
+            tail.update(tail.bs.next);
+            return tail;
+        }
+
+        /**
+         * construct an element in place before pos.
+         * return an iterator pointing to it.
+         */
+        template <class... Args>
+        iterator emplace(iterator pos, Args&&... args) {
+            if (!owns(pos)) {
+                throw invalid_iterator();
+            }
+			auto p1 = pos.pb;
+            int p = pos.pos;
             if (p1 == &bs) {
                 if (p1->prev == &bs) {
-                    p1->insert_before(makeBlock());
+                    makeBlock(p1);
                 }
                 p1 = p1->prev;
-                p = &p1->data->head;
+                p = p1->data->size;
             }
-            auto p2 = p1->data->insert_before(p, value);
+            place(p1, p, std::forward<Args>(args)...);
             size_c++;
-            update(p1);
-            return iterator(this, p2, pos.cur);
+            update(p1, p);
+            return iterator(this, p1, p, version);
         }
 
         /**
@@ -701,30 +2067,66 @@ namespace sjtu {
          * the iterator is invalid, or it points to a wrong place.
          */
         iterator erase(iterator pos) {
-            if (empty() || pos.from!=this) {
+            if (empty() || !owns(pos)) {
                 throw invalid_iterator();
             }
-            iterator nxt = pos+1;
-			auto p1 = pos.findBlock();
+			auto p1 = pos.pb;
+            int p = pos.pos;
             if (p1 == &bs) throw invalid_iterator();
-            p1->data->erase(pos.p);
-			nxt.cur--;
+            p1->data->erase(mem.alloc, p);
             size_c--;
-            update(p1);
-            return nxt;
+            update(p1, p);
+            return iterator(this, p1, p, version);
+        }
+
+        /**
+         * remove the elements in [first, last).
+         * the blocks strictly inside the range are unlinked whole.
+         * return an iterator pointing to the element that followed them.
+         */
+        iterator erase(iterator first, iterator last) {
+            if (!owns(first) || !owns(last)) {
+                throw invalid_iterator();
+            }
+            int idx = index(first.pb, first.pos), n = index(last.pb, last.pos) - idx;
+            if (n < 0) {
+                throw invalid_iterator();
+            }
+            if (n > 0) {
+                list<block> *right = cut(last.pb, last.pos), *x = cut(first.pb, first.pos);
+                for (; x != right; x = x->next, freeBlock(x->prev));
+                size_c -= n;
+                updateRange(right->prev, nullptr, right);
+            }
+            list<block> *x = find(idx);
+            return iterator(this, x, idx, version);
         }
 
         /**
          * add an element to the end.
          */
         void push_back(const T &value) {
+            emplace_back(value);
+        }
+        void push_back(T &&value) {
+            emplace_back(std::move(value));
+        }
+
+        /**
+         * construct an element in place at the end.
+         */
+        template <class... Args>
+        T &emplace_back(Args&&... args) {
             // insert(end(), value);
-            if (bs.prev == &bs) {
-                bs.insert_before(makeBlock());
+            if (bs.prev == &bs || (batch && bs.prev->data->size >= 2*bsize)) {
+                makeBlock(&bs);
             }
-            bs.prev->data->insert_before(&bs.prev->data->head, value);
+            auto *x = bs.prev;
+            int p = x->data->size;
+            place(x, p, std::forward<Args>(args)...);
             size_c++;
-            update(bs.prev);
+            update(x, p);
+            return x->data->at(p);
         }
 
         /**
@@ -736,7 +2138,7 @@ namespace sjtu {
                 throw container_is_empty();
             }
             // erase(end()-1);
-            bs.prev->data->erase(bs.prev->data->head.prev);
+            bs.prev->data->pop_back(mem.alloc);
             size_c--;
             update(bs.prev);
         }
@@ -745,13 +2147,27 @@ namespace sjtu {
          * insert an element to the beginning.
          */
         void push_front(const T &value) {
+            emplace_front(value);
+        }
+        void push_front(T &&value) {
+            emplace_front(std::move(value));
+        }
+
+        /**
+         * construct an element in place at the beginning.
+         */
+        template <class... Args>
+        T &emplace_front(Args&&... args) {
             // insert(begin(), value);
-            if (bs.next == &bs) {
-                bs.insert_after(makeBlock());
+            if (bs.next == &bs || (batch && bs.next->data->size >= 2*bsize)) {
+                makeBlock(bs.next);
             }
-            bs.next->data->insert_before(bs.next->data->head.next, value);
+            auto *x = bs.next;
+            int p = 0;
+            place(x, p, std::forward<Args>(args)...);
             size_c++;
-            update(bs.next);
+            update(x, p);
+            return x->data->at(p);
         }
 
         /**
@@ -763,12 +2179,93 @@ namespace sjtu {
                 throw container_is_empty();
 			}
             // erase(begin());
-            bs.next->data->erase(bs.next->data->head.next);
+            bs.next->data->pop_front(mem.alloc);
             size_c--;
             update(bs.next);
         }
     };
 
+    template <class T, class Allocator, class BlockPolicy>
+    void swap(deque<T, Allocator, BlockPolicy> &a, deque<T, Allocator, BlockPolicy> &b) noexcept {
+        a.swap(b);
+    }
+
+    /**
+     * Whole-deque algorithms running over segments(), so that the inner
+     * loops are plain array loops the compiler can vectorize.
+     */
+    template <class T, class Allocator, class BlockPolicy, class F>
+    F for_each(deque<T, Allocator, BlockPolicy> &d, F f) {
+        for (auto seg : d.segments()) {
+            for (T *p = seg.first; p != seg.last; ++p) f(*p);
+        }
+        return f;
+    }
+
+    template <class T, class Allocator, class BlockPolicy, class V>
+    V accumulate(const deque<T, Allocator, BlockPolicy> &d, V init) {
+        for (auto seg : d.segments()) {
+            for (const T *p = seg.first; p != seg.last; ++p) init = init + *p;
+        }
+        return init;
+    }
+
+    template <class T, class Allocator, class BlockPolicy, class V, class Op>
+    V accumulate(const deque<T, Allocator, BlockPolicy> &d, V init, Op op) {
+        for (auto seg : d.segments()) {
+            for (const T *p = seg.first; p != seg.last; ++p) init = op(init, *p);
+        }
+        return init;
+    }
+
+    //The first element equal to value, or end()
+    template <class T, class Allocator, class BlockPolicy, class V>
+    typename deque<T, Allocator, BlockPolicy>::iterator find(deque<T, Allocator, BlockPolicy> &d, const V &value) {
+        int idx = 0;
+        for (auto seg : d.segments()) {
+            for (T *p = seg.first; p != seg.last; ++p) {
+                if (*p == value) return d.begin() + (idx + (int)(p - seg.first));
+            }
+            idx += seg.size();
+        }
+        return d.end();
+    }
+
+    template <class T, class Allocator, class BlockPolicy, class V>
+    size_t count(const deque<T, Allocator, BlockPolicy> &d, const V &value) {
+        size_t n = 0;
+        for (auto seg : d.segments()) {
+            for (const T *p = seg.first; p != seg.last; ++p) n += *p == value;
+        }
+        return n;
+    }
+
+    template <class T, class Allocator, class BlockPolicy, class V>
+    void fill(deque<T, Allocator, BlockPolicy> &d, const V &value) {
+        for (auto seg : d.segments()) {
+            for (T *p = seg.first; p != seg.last; ++p) *p = value;
+        }
+    }
+
+    template <class T, class Allocator, class BlockPolicy, class OutputIt>
+    OutputIt copy(const deque<T, Allocator, BlockPolicy> &d, OutputIt out) {
+        for (auto seg : d.segments()) {
+            for (const T *p = seg.first; p != seg.last; ++p, ++out) *out = *p;
+        }
+        return out;
+    }
+
+#ifdef SJTU_DEQUE_HAS_PMR
+    namespace pmr {
+        /**
+         * deque drawing its memory from a std::pmr::memory_resource,
+         * e.g. sjtu::pmr::deque<int> d(&arena);
+         */
+        template <class T, class BlockPolicy = sqrt_blocks<>>
+        using deque = sjtu::deque<T, std::pmr::polymorphic_allocator<T>, BlockPolicy>;
+    }
+#endif
+
 }  // namespace sjtu
 
 #endif
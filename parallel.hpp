@@ -0,0 +1,309 @@
+#ifndef SJTU_PARALLEL_HPP
+#define SJTU_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "deque.hpp"
+#include "exceptions.hpp"
+
+namespace sjtu {
+namespace parallel {
+
+    /**
+     * Work-stealing thread pool.
+     * run(n, f) deals the tasks 0..n-1 round robin onto one queue per
+     * worker. A worker pops from the back of its own queue, and once that
+     * is empty steals from the front of the others. The calling thread
+     * works as worker 0 until every task has finished, then rethrows the
+     * first exception a task threw, if any.
+     * Calls to run() from different threads take turns. A run() from inside
+     * one of the pool's own tasks cannot wait for workers that may all be
+     * busy, so it runs its tasks inline on the calling thread.
+     */
+    class pool {
+    private:
+        struct queue {
+            std::mutex m;
+            std::deque<int> tasks;
+        };
+
+        unsigned n;
+        std::unique_ptr<queue[]> queues;
+        std::vector<std::thread> threads;
+        std::mutex runner;  //held for a whole run(), so that runs take turns
+        std::mutex m;
+        std::condition_variable wake, done;
+        std::function<void(int)> job;
+        std::atomic<int> left;  //tasks of the current run not finished yet
+        std::exception_ptr error;
+        unsigned round;  //bumped by every run() to wake the workers
+        bool stop;
+
+        //The pool whose tasks this thread is running, if any
+        static pool *&current() {
+            thread_local pool *p = nullptr;
+            return p;
+        }
+
+        bool take(unsigned self, int &task) {
+            for (unsigned i = 0; i < n; i++) {
+                queue &q = queues[(self + i) % n];
+                std::lock_guard<std::mutex> lock(q.m);
+                if (q.tasks.empty()) continue;
+                if (i == 0) {
+                    task = q.tasks.back();
+                    q.tasks.pop_back();
+                } else {
+                    task = q.tasks.front();
+                    q.tasks.pop_front();
+                }
+                return true;
+            }
+            return false;
+        }
+
+        void work(unsigned self) {
+            int task;
+            while (take(self, task)) {
+                try {
+                    job(task);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(m);
+                    if (!error) error = std::current_exception();
+                }
+                if (left.fetch_sub(1) == 1) {
+                    std::lock_guard<std::mutex> lock(m);
+                    done.notify_all();
+                }
+            }
+        }
+
+        void loop(unsigned self) {
+            current() = this;
+            unsigned seen = 0;
+            for (;;) {
+                {
+                    std::unique_lock<std::mutex> lock(m);
+                    wake.wait(lock, [&] { return stop || round != seen; });
+                    if (stop) return;
+                    seen = round;
+                }
+                work(self);
+            }
+        }
+
+    public:
+        explicit pool(unsigned n = std::thread::hardware_concurrency())
+            : n(n ? n : 1), queues(new queue[n ? n : 1]), left(0), round(0), stop(false) {
+            for (unsigned i = 1; i < this->n; i++) {
+                threads.emplace_back(&pool::loop, this, i);
+            }
+        }
+
+        ~pool() {
+            {
+                std::lock_guard<std::mutex> lock(m);
+                stop = true;
+            }
+            wake.notify_all();
+            for (auto &t : threads) t.join();
+        }
+
+        pool(const pool &) = delete;
+        pool &operator=(const pool &) = delete;
+
+        unsigned size() const {
+            return n;
+        }
+
+        //Run f(0), ..., f(tasks-1) on the pool and wait for all of them
+        template <class F>
+        void run(int tasks, F f) {
+            if (tasks <= 0) return;
+            if (current() == this) {
+                std::exception_ptr first;
+                for (int i = 0; i < tasks; i++) {
+                    try {
+                        f(i);
+                    } catch (...) {
+                        if (!first) first = std::current_exception();
+                    }
+                }
+                if (first) std::rethrow_exception(first);
+                return;
+            }
+            std::lock_guard<std::mutex> serial(runner);
+            {
+                std::lock_guard<std::mutex> lock(m);
+                job = f;
+                error = nullptr;
+                left = tasks;
+                for (int i = 0; i < tasks; i++) {
+                    queue &q = queues[i % n];
+                    std::lock_guard<std::mutex> qlock(q.m);
+                    q.tasks.push_back(i);
+                }
+                round++;
+            }
+            wake.notify_all();
+            pool *outer = current();
+            current() = this;
+            work(0);
+            current() = outer;
+            std::unique_lock<std::mutex> lock(m);
+            done.wait(lock, [&] { return left == 0; });
+            job = nullptr;
+            if (error) std::rethrow_exception(error);
+        }
+    };
+
+    //One pool with a worker per hardware thread, used by default
+    inline pool &default_pool() {
+        static pool p;
+        return p;
+    }
+
+    /**
+     * Cut the segments of d into tasks of whole blocks, about four per
+     * worker, so that no two workers ever touch the same block.
+     * Task t covers segs[cut[t]] up to segs[cut[t+1]] and its first element
+     * has index start[t].
+     */
+    template <class Deque, class Segment>
+    void partition(Deque &d, unsigned workers, std::vector<Segment> &segs, std::vector<size_t> &cut, std::vector<size_t> &start) {
+        size_t grain = d.size() / (4 * workers) + 1, run = 0, idx = 0;
+        if (grain < 4096) grain = 4096;
+        auto range = d.segments();
+        cut.push_back(0);
+        start.push_back(0);
+        for (auto it = range.begin(); it != range.end(); ++it) {
+            if (it.starts_block() && run >= grain) {
+                cut.push_back(segs.size());
+                start.push_back(idx);
+                run = 0;
+            }
+            segs.push_back(*it);
+            run += (*it).size();
+            idx += (*it).size();
+        }
+        cut.push_back(segs.size());
+    }
+
+    struct plus {
+        template <class A, class B>
+        A operator()(const A &a, const B &b) const {
+            return a + b;
+        }
+    };
+
+    template <class T, class Allocator, class BlockPolicy, class F>
+    void for_each(deque<T, Allocator, BlockPolicy> &d, F f, pool &p = default_pool()) {
+        std::vector<typename deque<T, Allocator, BlockPolicy>::segment> segs;
+        std::vector<size_t> cut, start;
+        partition(d, p.size(), segs, cut, start);
+        p.run(cut.size() - 1, [&](int t) {
+            for (size_t i = cut[t]; i < cut[t+1]; i++) {
+                for (T *q = segs[i].first; q != segs[i].last; ++q) f(*q);
+            }
+        });
+    }
+
+    //Replace every element x of d by f(x)
+    template <class T, class Allocator, class BlockPolicy, class F>
+    void transform(deque<T, Allocator, BlockPolicy> &d, F f, pool &p = default_pool()) {
+        for_each(d, [&](T &x) { x = f(x); }, p);
+    }
+
+    /**
+     * Write f(x) for every element x of in to the element of out at the
+     * same index. out must have as many elements as in.
+     */
+    template <class T, class A1, class P1, class U, class A2, class P2, class F>
+    void transform(const deque<T, A1, P1> &in, deque<U, A2, P2> &out, F f, pool &p = default_pool()) {
+        if (in.size() != out.size()) {
+            throw runtime_error();
+        }
+        if (in.empty()) return;
+        std::vector<typename deque<T, A1, P1>::const_segment> segs;
+        std::vector<typename deque<U, A2, P2>::segment> osegs;
+        std::vector<size_t> cut, start, ocut, ostart;
+        partition(in, p.size(), segs, cut, start);
+        size_t idx = 0;
+        for (auto seg : out.segments()) {
+            osegs.push_back(seg);
+            ostart.push_back(idx);
+            idx += seg.size();
+        }
+        p.run(cut.size() - 1, [&](int t) {
+            size_t j = std::upper_bound(ostart.begin(), ostart.end(), start[t]) - ostart.begin() - 1;
+            U *o = osegs[j].first + (start[t] - ostart[j]);
+            for (size_t i = cut[t]; i < cut[t+1]; i++) {
+                for (const T *q = segs[i].first; q != segs[i].last; ++q) {
+                    if (o == osegs[j].last) o = osegs[++j].first;
+                    *o++ = f(*q);
+                }
+            }
+        });
+    }
+
+    /**
+     * Fold the elements of d into init with op, which must be associative
+     * and commutative since the blocks are reduced separately first.
+     */
+    template <class T, class Allocator, class BlockPolicy, class V, class Op>
+    V reduce(const deque<T, Allocator, BlockPolicy> &d, V init, Op op, pool &p = default_pool()) {
+        std::vector<typename deque<T, Allocator, BlockPolicy>::const_segment> segs;
+        std::vector<size_t> cut, start;
+        partition(d, p.size(), segs, cut, start);
+        if (segs.empty()) return init;
+        std::vector<V> part(cut.size() - 1, init);
+        p.run(cut.size() - 1, [&](int t) {
+            const T *q = segs[cut[t]].first;
+            V acc = *q++;
+            for (size_t i = cut[t]; i < cut[t+1]; i++) {
+                for (; q != segs[i].last; ++q) acc = op(acc, *q);
+                if (i + 1 < cut[t+1]) q = segs[i+1].first;
+            }
+            part[t] = acc;
+        });
+        for (auto &x : part) init = op(init, x);
+        return init;
+    }
+
+    template <class T, class Allocator, class BlockPolicy, class V>
+    V reduce(const deque<T, Allocator, BlockPolicy> &d, V init, pool &p = default_pool()) {
+        return reduce(d, init, plus(), p);
+    }
+
+    template <class T, class Allocator, class BlockPolicy, class Pred>
+    size_t count_if(const deque<T, Allocator, BlockPolicy> &d, Pred pred, pool &p = default_pool()) {
+        std::vector<typename deque<T, Allocator, BlockPolicy>::const_segment> segs;
+        std::vector<size_t> cut, start;
+        partition(d, p.size(), segs, cut, start);
+        std::vector<size_t> part(cut.size() - 1, 0);
+        p.run(cut.size() - 1, [&](int t) {
+            size_t n = 0;
+            for (size_t i = cut[t]; i < cut[t+1]; i++) {
+                for (const T *q = segs[i].first; q != segs[i].last; ++q) n += pred(*q) ? 1 : 0;
+            }
+            part[t] = n;
+        });
+        size_t n = 0;
+        for (size_t x : part) n += x;
+        return n;
+    }
+
+}  // namespace parallel
+}  // namespace sjtu
+
+#endif
@@ -0,0 +1,215 @@
+#ifndef SJTU_SORT_HPP
+#define SJTU_SORT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "deque.hpp"
+#include "parallel.hpp"
+
+namespace sjtu {
+
+    namespace detail {
+
+        /**
+         * Merge the sorted runs [first[i], last[i]), given in deque order, into
+         * out with a loser tree: one comparison per tree level for each
+         * element, ties going to the earlier run. A used up run's head is
+         * nullptr and loses to everything.
+         */
+        template <class T, class Deque, class Compare>
+        void merge(std::vector<T *> &head, const std::vector<T *> &last, Deque &out, Compare comp) {
+            size_t k = head.size(), m = 1;
+            for (; m < k; m *= 2);
+            head.resize(m, nullptr);
+            auto before = [&](size_t a, size_t b) {
+                T *x = head[a], *y = head[b];
+                if (!x) return false;
+                if (!y) return true;
+                if (comp(*x, *y)) return true;
+                if (comp(*y, *x)) return false;
+                return a < b;
+            };
+            //tree[i] is the loser at node i, win[i] the winner below it while building
+            std::vector<size_t> tree(m), win(2*m);
+            for (size_t i = 0; i < m; i++) win[m+i] = i;
+            for (size_t i = m - 1; i > 0; i--) {
+                size_t a = win[2*i], b = win[2*i+1];
+                if (before(a, b)) {
+                    win[i] = a;
+                    tree[i] = b;
+                } else {
+                    win[i] = b;
+                    tree[i] = a;
+                }
+            }
+            typename Deque::batch_guard guard(out);
+            for (size_t w = win[1]; head[w]; ) {
+                out.emplace_back(std::move(*head[w]));
+                if (++head[w] == last[w]) head[w] = nullptr;
+                for (size_t i = (w + m) / 2; i > 0; i /= 2) {
+                    if (before(tree[i], w)) std::swap(tree[i], w);
+                }
+            }
+        }
+
+        //Move the merged parts back into d: relink their blocks if d can own them...
+        template <class Deque, class Piece>
+        void gather(Deque &d, std::vector<Piece> &piece, std::true_type) {
+            Deque out(d.get_allocator());
+            for (auto &x : piece) out.append(std::move(x));
+            d = std::move(out);
+        }
+
+        //...or else move the elements into d's slots one by one
+        template <class Deque, class Piece>
+        void gather(Deque &d, std::vector<Piece> &piece, std::false_type) {
+            auto seg = d.segments().begin();
+            auto *q = (*seg).first;
+            for (auto &x : piece) {
+                for (auto part : x.segments()) {
+                    for (auto *r = part.first; r != part.last; ++r) {
+                        while (q == (*seg).last) q = (*++seg).first;
+                        *q++ = std::move(*r);
+                    }
+                }
+                x.clear();
+            }
+        }
+
+        /**
+         * Sort every segment of d on its own, then merge them.
+         * The merge is cut by value into parts: splitters are sampled from
+         * the sorted segments and each part collects, from every segment,
+         * the elements between two splitters, so that parts are independent.
+         * Every part is merged on the pool into a deque of its own and the
+         * parts are spliced back together in order. Those deques use
+         * std::allocator, which any worker may call, and never d's
+         * allocator, which need not be thread-safe (a monotonic_buffer_resource
+         * is not): unless d uses std::allocator too, the merged elements are
+         * moved back into d's slots on the calling thread instead.
+         * Ties go to the earlier segment, so with a stable local sort the
+         * whole is stable.
+         * The merge only pays off when the local sorts and the parts run on
+         * several workers: on one core, merging 10M ints out of some 3200
+         * blocks takes about 3.0 s against 1.6 s for sorting them in a
+         * vector. So with a single worker, or a deque too small to cut into
+         * parts, the elements are sorted in a vector and moved back into
+         * their slots instead.
+         */
+        template <class T, class Allocator, class BlockPolicy, class Compare, class LocalSort>
+        void sort(deque<T, Allocator, BlockPolicy> &d, Compare comp, LocalSort local, parallel::pool &p) {
+            typedef deque<T, Allocator, BlockPolicy> Deque;
+            if (d.size() < 2) return;
+            if (p.size() == 1 || d.size() < 65536) {
+                std::vector<T, Allocator> v(d.get_allocator());
+                v.reserve(d.size());
+                for (auto seg : d.segments()) {
+                    for (T *q = seg.first; q != seg.last; ++q) v.push_back(std::move(*q));
+                }
+                local(v.data(), v.data() + v.size(), comp);
+                size_t i = 0;
+                for (auto seg : d.segments()) {
+                    for (T *q = seg.first; q != seg.last; ++q) *q = std::move(v[i++]);
+                }
+                return;
+            }
+            std::vector<typename Deque::segment> segs;
+            std::vector<size_t> cut, start;
+            parallel::partition(d, p.size(), segs, cut, start);
+            p.run(cut.size() - 1, [&](int t) {
+                for (size_t i = cut[t]; i < cut[t+1]; i++) local(segs[i].first, segs[i].last, comp);
+            });
+
+            //Splitters, about 2 parts per worker
+            size_t parts = 2 * p.size(), k = segs.size();
+            std::vector<T *> sample;
+            for (auto &seg : segs) {
+                size_t n = seg.size(), step = n / parts + 1;
+                for (size_t i = step / 2; i < n; i += step) sample.push_back(seg.first + i);
+            }
+            std::sort(sample.begin(), sample.end(), [&](T *a, T *b) { return comp(*a, *b); });
+            std::vector<T *> splitter;
+            for (size_t i = 1; i < parts && !sample.empty(); i++) {
+                splitter.push_back(sample[i * sample.size() / parts]);
+            }
+            parts = splitter.size() + 1;
+
+            //bound[i][j]: where part j starts within segment i
+            std::vector<std::vector<T *>> bound(k, std::vector<T *>(parts + 1));
+            for (size_t i = 0; i < k; i++) {
+                bound[i][0] = segs[i].first;
+                bound[i][parts] = segs[i].last;
+                for (size_t j = 1; j < parts; j++) {
+                    bound[i][j] = std::lower_bound(bound[i][j-1], segs[i].last, *splitter[j-1], comp);
+                }
+            }
+
+            typedef deque<T, std::allocator<T>, BlockPolicy> Piece;
+            std::vector<Piece> piece(parts);
+            p.run(parts, [&](int j) {
+                std::vector<T *> head, last;
+                for (size_t i = 0; i < k; i++) {
+                    if (bound[i][j] != bound[i][j+1]) {
+                        head.push_back(bound[i][j]);
+                        last.push_back(bound[i][j+1]);
+                    }
+                }
+                merge(head, last, piece[j], comp);
+            });
+
+            gather(d, piece, std::is_same<Deque, Piece>());
+        }
+
+        struct local_sort {
+            template <class T, class Compare>
+            void operator()(T *first, T *last, Compare comp) const {
+                std::sort(first, last, comp);
+            }
+        };
+
+        struct local_stable_sort {
+            template <class T, class Compare>
+            void operator()(T *first, T *last, Compare comp) const {
+                std::stable_sort(first, last, comp);
+            }
+        };
+
+    }  // namespace detail
+
+    /**
+     * Sort the deque by comp. With several workers the blocks are sorted in
+     * parallel and merged into fresh blocks, see detail::sort. Iterators
+     * into d are invalidated.
+     * d's allocator is only called from the calling thread, so it need not
+     * be thread-safe. The workers move and compare elements, so moving
+     * distinct elements of T at once must be safe.
+     */
+    template <class T, class Allocator, class BlockPolicy, class Compare>
+    void sort(deque<T, Allocator, BlockPolicy> &d, Compare comp, parallel::pool &p = parallel::default_pool()) {
+        detail::sort(d, comp, detail::local_sort(), p);
+    }
+    template <class T, class Allocator, class BlockPolicy>
+    void sort(deque<T, Allocator, BlockPolicy> &d) {
+        sjtu::sort(d, std::less<T>());
+    }
+
+    //As sort, with the same demands on the allocator and on T, but equal
+    //elements keep their order
+    template <class T, class Allocator, class BlockPolicy, class Compare>
+    void stable_sort(deque<T, Allocator, BlockPolicy> &d, Compare comp, parallel::pool &p = parallel::default_pool()) {
+        detail::sort(d, comp, detail::local_stable_sort(), p);
+    }
+    template <class T, class Allocator, class BlockPolicy>
+    void stable_sort(deque<T, Allocator, BlockPolicy> &d) {
+        sjtu::stable_sort(d, std::less<T>());
+    }
+
+}  // namespace sjtu
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef SJTU_SPSC_HPP
+#define SJTU_SPSC_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "deque.hpp"
+
+namespace sjtu {
+
+    /**
+     * Lock-free queue between exactly one producer thread, which calls
+     * push_back / emplace_back, and one consumer thread, which calls
+     * try_pop_front / empty.
+     * Like deque it keeps its elements in a chain of blocks, here all of
+     * the full size BlockPolicy allows. The producer fills the tail block
+     * and publishes each element with a release store of the block's end,
+     * the consumer drains the head block and moves on once it is full and
+     * has a successor. Drained blocks go onto a lock-free free list that
+     * the producer takes from before allocating.
+     */
+    template <class T, class Allocator = std::allocator<T>, class BlockPolicy = byte_blocks<>>
+    class spsc_deque {
+    private:
+        struct block {
+            T *buf;
+            std::atomic<int> end;  //elements published so far
+            std::atomic<block *> next;  //successor in the chain, or on the free list
+        };
+
+        typedef std::allocator_traits<Allocator> traits;
+        typedef typename traits::template rebind_alloc<block> block_allocator;
+        typedef std::allocator_traits<block_allocator> block_traits;
+
+        Allocator alloc;
+        int cap;
+        std::atomic<block *> spare;  //free list, pushed by the consumer
+
+        //Producer side, on a cache line of its own
+        alignas(64) block *tail;
+        int tpos;
+        block *cache;  //free blocks taken from spare in one go
+
+        //Consumer side
+        alignas(64) block *head;
+        int hpos, hend;  //hend: head->end as last seen
+
+        block *makeBlock() {
+            block_allocator ba(alloc);
+            block *x = block_traits::allocate(ba, 1);
+            try {
+                x->buf = traits::allocate(alloc, cap);
+            } catch (...) {
+                block_traits::deallocate(ba, x, 1);
+                throw;
+            }
+            new (&x->end) std::atomic<int>(0);
+            new (&x->next) std::atomic<block *>(nullptr);
+            return x;
+        }
+
+        void freeBlock(block *x) {
+            traits::deallocate(alloc, x->buf, cap);
+            block_allocator ba(alloc);
+            block_traits::deallocate(ba, x, 1);
+        }
+
+        //Free a list of empty blocks linked through next
+        void freeList(block *x) {
+            while (x) {
+                block *tmp = x->next.load(std::memory_order_relaxed);
+                freeBlock(x);
+                x = tmp;
+            }
+        }
+
+        //Producer: an empty block, recycled if possible
+        block *takeBlock() {
+            if (!cache) cache = spare.exchange(nullptr, std::memory_order_acquire);
+            if (!cache) return makeBlock();
+            block *x = cache;
+            cache = x->next.load(std::memory_order_relaxed);
+            x->end.store(0, std::memory_order_relaxed);
+            x->next.store(nullptr, std::memory_order_relaxed);
+            return x;
+        }
+
+        //Consumer: hand a drained block back to the producer
+        void recycle(block *x) {
+            block *top = spare.load(std::memory_order_relaxed);
+            do {
+                x->next.store(top, std::memory_order_relaxed);
+            } while (!spare.compare_exchange_weak(top, x, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        //Producer: make room for one more element at the tail
+        void reserve() {
+            if (tpos < cap) return;
+            block *x = takeBlock();
+            tail->next.store(x, std::memory_order_release);
+            tail = x;
+            tpos = 0;
+        }
+
+        void publish() {
+            tail->end.store(++tpos, std::memory_order_release);
+        }
+
+    public:
+        explicit spsc_deque(const Allocator &alloc = Allocator())
+            : alloc(alloc), cap(2 * BlockPolicy::size(0, sizeof(T))), spare(nullptr), tpos(0), cache(nullptr), hpos(0), hend(0) {
+            head = tail = makeBlock();
+        }
+
+        spsc_deque(const spsc_deque &) = delete;
+        spsc_deque &operator=(const spsc_deque &) = delete;
+
+        /**
+         * Destroys what is left in the queue. Neither side may be in use
+         * any more.
+         */
+        ~spsc_deque() {
+            for (block *x = head; x; ) {
+                int end = x->end.load(std::memory_order_acquire);
+                for (int i = x == head ? hpos : 0; i < end; i++) traits::destroy(alloc, x->buf + i);
+                block *tmp = x->next.load(std::memory_order_relaxed);
+                freeBlock(x);
+                x = tmp;
+            }
+            freeList(cache);
+            freeList(spare.load(std::memory_order_acquire));
+        }
+
+        /**
+         * Producer only.
+         */
+        template <class... Args>
+        void emplace_back(Args &&... args) {
+            reserve();
+            traits::construct(alloc, tail->buf + tpos, std::forward<Args>(args)...);
+            publish();
+        }
+        void push_back(const T &value) {
+            emplace_back(value);
+        }
+        void push_back(T &&value) {
+            emplace_back(std::move(value));
+        }
+
+        /**
+         * Consumer only: move the front element into out and remove it.
+         * Returns false, leaving out alone, if nothing has been published.
+         */
+        bool try_pop_front(T &out) {
+            if (hpos == hend) {
+                hend = head->end.load(std::memory_order_acquire);
+                if (hpos == hend) {
+                    if (hend < cap) return false;
+                    block *x = head->next.load(std::memory_order_acquire);
+                    if (!x) return false;
+                    recycle(head);
+                    head = x;
+                    hpos = 0;
+                    hend = x->end.load(std::memory_order_acquire);
+                    if (!hend) return false;
+                }
+            }
+            T &x = head->buf[hpos++];
+            out = std::move(x);
+            traits::destroy(alloc, &x);
+            return true;
+        }
+
+        /**
+         * Consumer only: whether no element is ready to pop. The producer
+         * may publish one right after.
+         */
+        bool empty() const {
+            if (hpos < hend || hpos < head->end.load(std::memory_order_acquire)) return false;
+            if (hpos < cap) return true;
+            block *x = head->next.load(std::memory_order_acquire);
+            return !x || !x->end.load(std::memory_order_acquire);
+        }
+    };
+
+}  // namespace sjtu
+
+#endif
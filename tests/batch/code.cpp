@@ -0,0 +1,166 @@
+#include "deque.hpp"
+#include "../common.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <string>
+
+/*
+ * batch_guard: operations under a guard against std::deque, nested guards
+ * rebalancing only when the outermost one goes away, rebalancing that runs
+ * out of memory, which must leave the deque unbalanced but valid instead of
+ * throwing from the guard's destructor, and many inserts at one position,
+ * which must still split blocks that grow too large.
+ */
+
+typedef small_deque<std::string, counted<std::string>> Limited;
+typedef sjtu::deque<std::string, std::allocator<std::string>, sjtu::incremental_blocks<sjtu::fixed_blocks<4>>> Incremental;
+
+//n elements e0, e1, ..., pushed at the back
+template <class Deque>
+void buildBack(Deque &b, std::deque<std::string> &a, int n) {
+    for (int i = 0; i < n; i++) {
+        std::string s = "e" + std::to_string(i);
+        b.push_back(s);
+        a.push_back(s);
+    }
+}
+
+//The largest block, from the segments (a wrapped block gives two)
+template <class Deque>
+int largest(const Deque &b) {
+    int best = 0, cur = 0;
+    auto range = b.segments();
+    for (auto it = range.begin(); it != range.end(); ++it) {
+        if (it.starts_block()) cur = 0;
+        cur += (*it).size();
+        if (cur > best) best = cur;
+    }
+    return best;
+}
+
+template <class Deque>
+void randomOps(Deque &b, std::deque<std::string> &a, int times) {
+    for (int t = 0; t < times; t++) {
+        std::string s = "r" + std::to_string(t);
+        int pos = rand() % (a.size() + 1);
+        switch (rand() % 6) {
+        case 0:
+            b.push_back(s);
+            a.push_back(s);
+            break;
+        case 1:
+            b.push_front(s);
+            a.push_front(s);
+            break;
+        case 2:
+        case 3:
+            b.insert(b.begin() + pos, s);
+            a.insert(a.begin() + pos, s);
+            break;
+        default:
+            if (pos == (int)a.size()) break;
+            b.erase(b.begin() + pos);
+            a.erase(a.begin() + pos);
+        }
+    }
+}
+
+bool underGuard() {
+    Small b;
+    std::deque<std::string> a;
+    buildBack(b, a, 100);
+    {
+        Small::batch_guard guard(b);
+        randomOps(b, a, 3000);
+        if (!same(b, a)) return false;
+    }
+    return same(b, a) && largest(b) <= 8;
+}
+
+bool nested() {
+    Small b;
+    std::deque<std::string> a;
+    buildBack(b, a, 40);
+    {
+        Small::batch_guard outer(b);
+        {
+            Small::batch_guard inner(b);
+            for (int i = 0; i < 100; i++) {
+                b.insert(b.begin() + 20, "n" + std::to_string(i));
+                a.insert(a.begin() + 20, "n" + std::to_string(i));
+            }
+        }
+        //Only the outer guard rebalances
+        if (!same(b, a) || largest(b) <= 8) return false;
+        {
+            Small::batch_guard inner(b);
+        }
+        if (largest(b) <= 8) return false;
+    }
+    return same(b, a) && largest(b) <= 8;
+}
+
+//Rebalancing that fails after any number of allocations
+bool outOfMemory() {
+    for (long limit = 0; limit < 40; limit++) {
+        {
+            Limited b;
+            std::deque<std::string> a;
+            buildBack(b, a, 40);
+            {
+                Limited::batch_guard guard(b);
+                for (int i = 0; i < 200; i++) {
+                    b.insert(b.begin() + 20, "m" + std::to_string(i));
+                    a.insert(a.begin() + 20, "m" + std::to_string(i));
+                }
+                budget = limit;
+            }
+            budget = -1;
+            if (!same(b, a)) return false;
+            //Still fully usable, and a later guard can finish the job
+            randomOps(b, a, 500);
+            if (!same(b, a)) return false;
+            {
+                Limited::batch_guard guard(b);
+                randomOps(b, a, 50);
+            }
+            if (!same(b, a) || largest(b) > 8) return false;
+        }
+        if (live) return false;
+    }
+    return true;
+}
+
+//Every insert at the same position, so one block takes them all
+template <class Deque>
+bool onePosition() {
+    Deque b;
+    std::deque<std::string> a;
+    buildBack(b, a, 40);
+    {
+        typename Deque::batch_guard guard(b);
+        for (int i = 0; i < 3000; i++) {
+            b.insert(b.begin() + 20, "p" + std::to_string(i));
+            a.insert(a.begin() + 20, "p" + std::to_string(i));
+            if (largest(b) > 16) return false;
+        }
+        if (!same(b, a)) return false;
+    }
+    return same(b, a) && largest(b) <= 8;
+}
+
+int main() {
+    srand(16);
+    puts("---------------------------------------------------------------------------");
+    puts("batch_guard...");
+    printf("Test 1: operations under a guard                                   %s\n", underGuard() ? "PASSED" : "FAILED");
+    printf("Test 2: nested guards                                              %s\n", nested() ? "PASSED" : "FAILED");
+    printf("Test 3: out of memory while rebalancing                            %s\n", outOfMemory() ? "PASSED" : "FAILED");
+    printf("Test 4: inserts at one position, amortized                         %s\n", onePosition<Small>() ? "PASSED" : "FAILED");
+    printf("Test 5: inserts at one position, incremental                       %s\n", onePosition<Incremental>() ? "PASSED" : "FAILED");
+    puts("---------------------------------------------------------------------------");
+    return 0;
+}
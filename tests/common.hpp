@@ -0,0 +1,130 @@
+#ifndef SJTU_TESTS_COMMON_HPP
+#define SJTU_TESTS_COMMON_HPP
+
+#include "deque.hpp"
+
+#include <deque>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <type_traits>
+
+/*
+ * Helpers shared by the tests that check a deque against a std::deque or
+ * std::vector holding the same elements.
+ */
+
+//Tiny blocks, so that block boundaries are everywhere
+template <class T, class Allocator = std::allocator<T>>
+using small_deque = sjtu::deque<T, Allocator, sjtu::fixed_blocks<4>>;
+
+typedef small_deque<std::string> Small;
+typedef sjtu::deque<std::string> Large;
+
+//Whether b holds the elements of a in order, compared by eq(b[i], a[i])
+template <class Deque, class Ref, class Eq>
+bool same(const Deque &b, const Ref &a, Eq eq) {
+    if (a.size() != b.size()) return false;
+    size_t i = 0;
+    for (auto it = b.cbegin(); it != b.cend(); ++it, ++i) {
+        if (!eq(*it, a[i])) return false;
+    }
+    return true;
+}
+template <class Deque, class Ref>
+bool same(const Deque &b, const Ref &a) {
+    return same(b, a, [](const typename Deque::value_type &x, const typename Ref::value_type &y) { return x == y; });
+}
+
+//n elements value(0), value(1), ..., pushed at both ends in turn
+template <class Deque, class Ref, class Value, class = typename std::enable_if<!std::is_convertible<Value, std::string>::value>::type>
+void build(Deque &b, Ref &a, int n, Value value) {
+    for (int i = 0; i < n; i++) {
+        auto v = value(i);
+        if (i % 2) {
+            a.push_back(v);
+            b.push_back(v);
+        } else {
+            a.push_front(v);
+            b.push_front(v);
+        }
+    }
+}
+
+//n strings tag0, tag1, ...
+template <class Deque>
+void build(Deque &b, std::deque<std::string> &a, int n, const std::string &tag = "e") {
+    build(b, a, n, [&](int i) { return tag + std::to_string(i); });
+}
+
+//std::deque mishandles an empty insert in the middle, so skip it there
+inline void insertRef(std::deque<std::string> &a, int pos, int count, const std::string &v) {
+    if (count) a.insert(a.begin() + pos, count, v);
+}
+template <class Range>
+void insertRef(std::deque<std::string> &a, int pos, const Range &v) {
+    if (!v.empty()) a.insert(a.begin() + pos, v.begin(), v.end());
+}
+
+//Allocations a deque holds, by its own counters
+template <class Deque>
+long held(const Deque &b) {
+    return (long)b.allocations() - (long)b.deallocations();
+}
+
+//Allocations made through counted and not yet returned, and how many
+//more it may make before it throws bad_alloc, -1 for no limit
+inline long live = 0;
+inline long budget = -1;
+
+template <class T>
+struct counted {
+    typedef T value_type;
+
+    counted() = default;
+    template <class U>
+    counted(const counted<U> &) {}
+
+    T *allocate(size_t n) {
+        if (budget == 0) throw std::bad_alloc();
+        if (budget > 0) budget--;
+        live++;
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T *p, size_t n) {
+        live--;
+        std::allocator<T>().deallocate(p, n);
+    }
+};
+template <class T, class U>
+bool operator==(const counted<T> &, const counted<U> &) {
+    return true;
+}
+template <class T, class U>
+bool operator!=(const counted<T> &, const counted<U> &) {
+    return false;
+}
+
+//Counts the allocations that reach the resource below it
+class counting_resource : public std::pmr::memory_resource {
+public:
+    size_t allocs = 0;  //made so far
+    long live = 0;      //not yet returned
+
+private:
+    void *do_allocate(size_t bytes, size_t align) override {
+        allocs++;
+        live++;
+        return std::pmr::new_delete_resource()->allocate(bytes, align);
+    }
+    void do_deallocate(void *p, size_t bytes, size_t align) override {
+        live--;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+#endif
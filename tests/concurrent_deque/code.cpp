@@ -0,0 +1,134 @@
+#include "concurrent_deque.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Multi-producer, multi-consumer job queue: with t threads, the odd ones
+ * push jobs at the back and the even ones take them from the front, every
+ * job is taken exactly once and each producer's jobs come out in order.
+ * Throughput of concurrent_deque is compared with std::deque behind one
+ * std::mutex for t = 1 up to the number of hardware threads (at least 4).
+ */
+
+#define __OFFICAL
+
+static const int N = 2000000;  //jobs in every run
+
+struct Locked {
+    std::mutex m;
+    std::deque<long long> q;
+
+    void push_back(long long x) {
+        std::lock_guard<std::mutex> lock(m);
+        q.push_back(x);
+    }
+    bool try_pop_front(long long &x) {
+        std::lock_guard<std::mutex> lock(m);
+        if (q.empty()) return false;
+        x = q.front();
+        q.pop_front();
+        return true;
+    }
+};
+
+//A job is its producer in the high bits and a sequence number below
+template <class Queue>
+bool jobs(int threads, double &rate) {
+    Queue q;
+    int producers = threads / 2 > 0 ? threads / 2 : 1, consumers = threads - producers > 0 ? threads - producers : 1;
+    std::atomic<int> taken(0);
+    std::atomic<bool> ok(true);
+    std::vector<std::atomic<long long>> seen(producers);
+    for (auto &x : seen) x = 0;
+    auto produce = [&](int id) {
+        int n = N / producers + (id < N % producers);
+        for (long long i = 0; i < n; i++) q.push_back((long long)id << 32 | i);
+    };
+    //Take jobs until all N are taken, or with drain until none is left
+    auto consume = [&](bool drain) {
+        std::vector<long long> last(producers, -1);
+        long long x;
+        while (taken.load(std::memory_order_relaxed) < N) {
+            if (!q.try_pop_front(x)) {
+                if (drain) return;
+                std::this_thread::yield();
+                continue;
+            }
+            taken.fetch_add(1, std::memory_order_relaxed);
+            int id = x >> 32;
+            long long i = x & 0xffffffffLL;
+            if (i <= last[id]) ok = false;
+            last[id] = i;
+            seen[id].fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+    auto start = std::chrono::steady_clock::now();
+    if (threads == 1) {
+        //One thread alternates between pushing a batch and draining it
+        for (int id = 0, done = 0; done < N; ) {
+            int n = N - done < 1024 ? N - done : 1024;
+            for (int i = 0; i < n; i++) q.push_back((long long)id << 32 | (done + i));
+            done += n;
+            consume(true);
+        }
+    } else {
+        std::vector<std::thread> pool;
+        for (int i = 0; i < producers; i++) pool.emplace_back(produce, i);
+        for (int i = 0; i < consumers; i++) pool.emplace_back(consume, false);
+        for (auto &t : pool) t.join();
+    }
+    rate = N / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    long long total = 0;
+    for (auto &x : seen) total += x;
+    return ok && total == N;
+}
+
+//All four ends at once, then the remainder is drained and counted
+bool ends() {
+    sjtu::concurrent_deque<long long, std::allocator<long long>, sjtu::fixed_blocks<2>> q;
+    std::atomic<long long> pushed(0), popped(0);
+    std::vector<std::thread> pool;
+    for (int t = 0; t < 4; t++) {
+        pool.emplace_back([&, t] {
+            long long x;
+            for (int i = 0; i < 50000; i++) {
+                switch ((i * 7 + t) % 4) {
+                case 0: q.push_back(i); pushed += i; break;
+                case 1: q.push_front(i); pushed += i; break;
+                case 2: if (q.try_pop_back(x)) popped += x; break;
+                default: if (q.try_pop_front(x)) popped += x; break;
+                }
+            }
+        });
+    }
+    for (auto &t : pool) t.join();
+    long long x;
+    while (q.try_pop_front(x)) popped += x;
+    return q.empty() && pushed == popped;
+}
+
+int main() {
+    int most = std::thread::hardware_concurrency();
+    if (most < 4) most = 4;
+    puts("---------------------------------------------------------------------------");
+    puts("Multi-producer, multi-consumer...");
+    printf("Test 1: both ends at once                                          %s\n", ends() ? "PASSED" : "FAILED");
+    bool ok = true;
+    for (int t = 1; t <= most; t *= 2) {
+        double fast, slow;
+        ok = jobs<sjtu::concurrent_deque<long long>>(t, fast) && ok;
+        ok = jobs<Locked>(t, slow) && ok;
+#ifndef __OFFICAL
+        printf("%2d threads: concurrent_deque %6.1fM jobs/s, mutex and std::deque %6.1fM jobs/s\n", t, fast / 1e6, slow / 1e6);
+#endif
+    }
+    printf("Test 2: job queue from 1 to %-3s threads                            %s\n", "N", ok ? "PASSED" : "FAILED");
+    puts("---------------------------------------------------------------------------");
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include "deque.hpp"
+#include "../common.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+/*
+ * Copies of elements that throw part-way through copying a deque: the copy
+ * constructor must free everything it made before passing the exception
+ * on, copy assignment must leave its target as it was, and the source must
+ * be left as it was in both cases.
+ */
+
+long elements = 0;   //elements alive
+long copies = -1;    //copies left before one throws, -1 for no limit
+
+struct fragile {
+    std::string s;
+
+    explicit fragile(const std::string &s) : s(s) {
+        elements++;
+    }
+    fragile(const fragile &other) : s(other.s) {
+        if (copies == 0) throw 1;
+        if (copies > 0) copies--;
+        elements++;
+    }
+    fragile &operator=(const fragile &other) {
+        if (copies == 0) throw 1;
+        if (copies > 0) copies--;
+        s = other.s;
+        return *this;
+    }
+    ~fragile() {
+        elements--;
+    }
+};
+
+typedef sjtu::deque<fragile, counted<fragile>> LargeFragile;
+typedef small_deque<fragile, counted<fragile>> SmallFragile;
+
+template <class Deque>
+void build(Deque &b, int n, const std::string &tag) {
+    for (int i = 0; i < n; i++) {
+        if (i % 2) {
+            b.push_back(fragile(tag + std::to_string(i)));
+        } else {
+            b.push_front(fragile(tag + std::to_string(i)));
+        }
+    }
+}
+
+//b holds what build(b, n, tag) put there
+template <class Deque>
+bool intact(const Deque &b, int n, const std::string &tag) {
+    if ((int)b.size() != n) return false;
+    for (int i = 0; i < n; i++) {
+        int k = i < (n + 1) / 2 ? 2 * ((n + 1) / 2 - 1 - i) : 2 * (i - (n + 1) / 2) + 1;
+        if (b[i].s != tag + std::to_string(k)) return false;
+    }
+    return true;
+}
+
+template <class Deque>
+bool copyConstructor() {
+    for (int n : {1, 5, 100, 5000}) {
+        for (int limit : {0, n / 2, n - 1}) {
+            {
+                Deque b;
+                build(b, n, "e");
+                long before = elements;
+                int caught = 0;
+                copies = limit;
+                try {
+                    Deque c(b);
+                } catch (int) {
+                    caught++;
+                }
+                copies = -1;
+                if (caught != 1 || elements != before || !intact(b, n, "e")) return false;
+                Deque c(b);
+                if (!intact(c, n, "e")) return false;
+            }
+            if (live || elements) return false;
+        }
+    }
+    return true;
+}
+
+template <class Deque>
+bool copyAssignment() {
+    for (int n : {1, 5, 100, 5000}) {
+        for (int limit : {0, n / 2, n - 1}) {
+            for (int m : {0, 3, 300}) {
+                {
+                    Deque b, c;
+                    build(b, n, "e");
+                    build(c, m, "c");
+                    auto it = c.begin();
+                    long before = elements;
+                    int caught = 0;
+                    copies = limit;
+                    try {
+                        c = b;
+                    } catch (int) {
+                        caught++;
+                    }
+                    copies = -1;
+                    if (caught != 1 || elements != before) return false;
+                    if (!intact(b, n, "e") || !intact(c, m, "c") || it != c.begin()) return false;
+                    //Still fully usable
+                    c.push_back(fragile("x"));
+                    c.pop_back();
+                    c = b;
+                    if (!intact(c, n, "e")) return false;
+                }
+                if (live || elements) return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main() {
+    puts("---------------------------------------------------------------------------");
+    puts("copies that throw...");
+    printf("Test 1: copy constructor, small blocks                             %s\n", copyConstructor<SmallFragile>() ? "PASSED" : "FAILED");
+    printf("Test 2: copy constructor, default blocks                           %s\n", copyConstructor<LargeFragile>() ? "PASSED" : "FAILED");
+    printf("Test 3: copy assignment, small blocks                              %s\n", copyAssignment<SmallFragile>() ? "PASSED" : "FAILED");
+    printf("Test 4: copy assignment, default blocks                            %s\n", copyAssignment<LargeFragile>() ? "PASSED" : "FAILED");
+    puts("---------------------------------------------------------------------------");
+    return 0;
+}
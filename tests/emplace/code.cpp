@@ -0,0 +1,108 @@
+#include "deque.hpp"
+#include "../common.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <utility>
+
+/*
+ * Move-only elements: emplace_back, emplace_front, emplace, insert(pos,
+ * T&&) and erase on a deque of std::unique_ptr, checked against a
+ * std::deque of the values pointed to. A constructor that throws must
+ * leave the deque as it was, with no empty block behind.
+ */
+
+typedef std::unique_ptr<int> Ptr;
+typedef small_deque<Ptr> SmallPtrs;
+typedef sjtu::deque<Ptr> LargePtrs;
+
+bool pointsTo(const Ptr &p, int x) {
+    return p && *p == x;
+}
+
+template <class Deque>
+bool moveOnly() {
+    Deque b;
+    std::deque<int> a;
+    for (int t = 0; t < 20000; t++) {
+        int pos = rand() % (a.size() + 1);
+        switch (rand() % 6) {
+        case 0:
+            b.emplace_back(new int(t));
+            a.push_back(t);
+            break;
+        case 1:
+            b.emplace_front(new int(t));
+            a.push_front(t);
+            break;
+        case 2: {
+            auto it = b.emplace(b.begin() + pos, new int(t));
+            a.insert(a.begin() + pos, t);
+            if (it - b.begin() != pos || **it != t) return false;
+            break;
+        }
+        case 3: {
+            Ptr p(new int(t));
+            auto it = b.insert(b.begin() + pos, std::move(p));
+            a.insert(a.begin() + pos, t);
+            if (p || it - b.begin() != pos || **it != t) return false;
+            break;
+        }
+        default:
+            if (a.empty()) break;
+            pos = rand() % a.size();
+            auto it = b.erase(b.begin() + pos);
+            a.erase(a.begin() + pos);
+            if (it - b.begin() != pos) return false;
+        }
+    }
+    return same(b, a, pointsTo);
+}
+
+//Emplacing an element that throws while it is being built
+struct thrower {
+    explicit thrower(bool fail) {
+        if (fail) throw 1;
+    }
+};
+
+template <class Deque>
+bool throwing(int n) {
+    Deque b;
+    for (int i = 0; i < n; i++) b.emplace_back(false);
+    for (int t = 0; t < 3; t++) {
+        try {
+            switch (t) {
+            case 0:
+                b.emplace_back(true);
+                break;
+            case 1:
+                b.emplace_front(true);
+                break;
+            default:
+                b.emplace(b.end(), true);
+            }
+            return false;
+        } catch (int) {
+        }
+        if ((int)b.size() != n || b.end() - b.begin() != n) return false;
+        int k = 0;
+        for (auto it = b.begin(); it != b.end(); ++it) k++;
+        if (k != n) return false;
+    }
+    return true;
+}
+
+int main() {
+    srand(9);
+    puts("---------------------------------------------------------------------------");
+    puts("Move-only elements and emplace...");
+    printf("Test 1: unique_ptr, small blocks                                   %s\n", moveOnly<SmallPtrs>() ? "PASSED" : "FAILED");
+    printf("Test 2: unique_ptr, default blocks                                 %s\n", moveOnly<LargePtrs>() ? "PASSED" : "FAILED");
+    printf("Test 3: a throwing constructor, empty deque                        %s\n", throwing<sjtu::deque<thrower>>(0) ? "PASSED" : "FAILED");
+    printf("Test 4: a throwing constructor, non-empty deque                    %s\n", throwing<small_deque<thrower>>(8) ? "PASSED" : "FAILED");
+    puts("---------------------------------------------------------------------------");
+    return 0;
+}
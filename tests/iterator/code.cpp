@@ -0,0 +1,100 @@
+#include "deque.hpp"
+#include "../common.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Iterator conformance: the standard algorithms run on sjtu::deque
+ * iterators (sort, reverse, lower_bound, reverse iterators), and the
+ * block-wise copy, fill and find are picked up by unqualified calls.
+ */
+
+typedef sjtu::deque<int>::iterator It;
+typedef sjtu::deque<int>::const_iterator CIt;
+static_assert(std::is_same<std::iterator_traits<It>::iterator_category, std::random_access_iterator_tag>::value, "iterator category");
+static_assert(std::is_same<std::iterator_traits<CIt>::reference, const int &>::value, "const_iterator reference");
+static_assert(std::is_same<decltype(It() - It()), It::difference_type>::value, "iterator distance");
+static_assert(std::is_same<decltype(CIt() - CIt()), CIt::difference_type>::value, "const_iterator distance");
+static_assert(std::is_same<decltype(It() - CIt()), It::difference_type>::value, "mixed distance");
+static_assert(std::is_same<decltype(CIt() - It()), CIt::difference_type>::value, "mixed distance");
+#if __cplusplus >= 202002L && defined(__cpp_lib_concepts)
+static_assert(std::random_access_iterator<It>, "iterator concept");
+static_assert(std::random_access_iterator<CIt>, "const_iterator concept");
+static_assert(std::sized_sentinel_for<It, It>, "iterator sized sentinel");
+static_assert(std::sized_sentinel_for<CIt, CIt>, "const_iterator sized sentinel");
+static_assert(std::sized_sentinel_for<It, CIt> && std::sized_sentinel_for<CIt, It>, "mixed sized sentinel");
+#endif
+
+static const int N_ROUND = 200;
+
+bool algorithms() {
+    for (int t = 0; t < N_ROUND; t++) {
+        int n = rand() % 3000;
+        sjtu::deque<int> b;
+        std::deque<int> a;
+        build(b, a, n, [](int) { return rand() % 100; });
+        std::sort(b.begin(), b.end());
+        std::sort(a.begin(), a.end());
+        if (!same(b, a)) return false;
+        if (std::lower_bound(b.begin(), b.end(), 50) - b.begin() != std::lower_bound(a.begin(), a.end(), 50) - a.begin()) return false;
+        std::reverse(b.begin(), b.end());
+        std::reverse(a.begin(), a.end());
+        if (!std::equal(b.rbegin(), b.rend(), a.rbegin())) return false;
+        if (std::distance(b.begin(), b.end()) != n) return false;
+        if (n) {
+            int k = rand() % n;
+            It it = b.begin() + k;
+            if (b.begin()[k] != a[k] || (k + b.begin())[0] != a[k]) return false;
+            if (!(b.begin() <= it && it < b.end() && b.cend() > it && it >= b.cbegin())) return false;
+            CIt cit = b.cbegin() + k;
+            if (it - b.cbegin() != k || cit - b.begin() != k || b.end() - cit != n - k || b.cend() - it != n - k) return false;
+        }
+    }
+    return true;
+}
+
+bool segmented() {
+    using std::copy;
+    using std::fill;
+    using std::find;
+    for (int t = 0; t < N_ROUND; t++) {
+        int n = rand() % 3000;
+        sjtu::deque<int> b;
+        std::deque<int> a;
+        for (int i = 0; i < n; i++) {
+            int x = rand() % 100;
+            a.push_front(x);
+            b.push_front(x);
+        }
+        const sjtu::deque<int> &cb = b;
+        int l = rand() % (n + 1), r = l + rand() % (n - l + 1), x = rand() % 100;
+        std::vector<int> u, v, w;
+        std::copy(a.begin() + l, a.begin() + r, std::back_inserter(u));
+        copy(b.begin() + l, b.begin() + r, std::back_inserter(v));
+        copy(cb.begin() + l, cb.begin() + r, std::back_inserter(w));
+        if (u != v || u != w) return false;
+        int pos = std::find(a.begin() + l, a.begin() + r, x) - a.begin();
+        if (find(b.begin() + l, b.begin() + r, x) - b.begin() != pos) return false;
+        if (find(cb.begin() + l, cb.begin() + r, x) - cb.begin() != pos) return false;
+        std::fill(a.begin() + l, a.begin() + r, -1);
+        fill(b.begin() + l, b.begin() + r, -1);
+        if (!same(b, a)) return false;
+    }
+    return true;
+}
+
+int main() {
+    srand(7);
+    puts("---------------------------------------------------------------------------");
+    puts("Iterator conformance...");
+    printf("Test 1: standard algorithms                                        %s\n", algorithms() ? "PASSED" : "FAILED");
+    printf("Test 2: block-wise copy, fill and find                             %s\n", segmented() ? "PASSED" : "FAILED");
+    puts("---------------------------------------------------------------------------");
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "deque.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+/*
+ * Latency benchmark: the cost of every single operation is recorded and
+ * the tail (p99, p99.9, p99.99, max) is compared between the amortized
+ * default and incremental_blocks, which spreads splits and merges out.
+ * An insert is timed together with the lookup of its position, which is
+ * where the block directory gets rebuilt after a block came or went.
+ */
+
+#define __OFFICAL
+
+static const int N = 1000000;
+static const int N_INSERT = 100000;
+
+typedef sjtu::deque<int> Amortized;
+typedef sjtu::deque<int, std::allocator<int>, sjtu::incremental_blocks<>> Incremental;
+
+struct Latency {
+    std::vector<double> ns;
+
+    template <class F>
+    void record(F f) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        ns.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+    }
+    double at(double q) {
+        std::sort(ns.begin(), ns.end());
+        return ns[std::min(ns.size() - 1, (size_t)(q * ns.size()))];
+    }
+};
+
+template <class Deque>
+bool run(Latency &push, Latency &insert, Latency &pop) {
+    std::deque<int> a;
+    Deque b;
+    srand(7);
+    for (int i = 0; i < N; i++) {
+        a.push_back(i);
+        push.record([&] { b.push_back(i); });
+    }
+    for (int i = 0; i < N_INSERT; i++) {
+        int pos = rand() % (a.size() + 1);
+        a.insert(a.begin() + pos, i);
+        insert.record([&] { b.insert(b.begin() + pos, i); });
+    }
+    for (int i = 0; i < N / 2; i++) {
+        a.pop_front();
+        pop.record([&] { b.pop_front(); });
+    }
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i] != b[i]) return false;
+    }
+    return true;
+}
+
+template <class Deque>
+bool report(const char *name) {
+    Latency push, insert, pop;
+    bool ok = run<Deque>(push, insert, pop);
+    printf("%-12s%s\n", name, ok ? "PASSED" : "FAILED");
+#ifndef __OFFICAL
+    const char *op[] = {"push_back", "insert", "pop_front"};
+    Latency *l[] = {&push, &insert, &pop};
+    for (int i = 0; i < 3; i++) {
+        printf("  %-10s p50 %7.0fns  p99 %7.0fns  p99.9 %7.0fns  p99.99 %7.0fns  max %9.0fns\n", op[i],
+               l[i]->at(0.5), l[i]->at(0.99), l[i]->at(0.999), l[i]->at(0.9999), l[i]->at(1));
+    }
+#endif
+    return ok;
+}
+
+int main() {
+    puts("---------------------------------------------------------------------------");
+    puts("Per-operation latency...");
+    report<Amortized>("amortized");
+    report<Incremental>("incremental");
+    puts("---------------------------------------------------------------------------");
+    return 0;
+}
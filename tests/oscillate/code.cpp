@@ -0,0 +1,93 @@
+#include "deque.hpp"
+
+#include <cstdio>
+#include <ctime>
+#include <deque>
+
+/*
+ * Oscillation benchmark: the deque hovers around a fixed size, at the
+ * boundaries where a block is about to be split, merged or emptied.
+ * Once warmed up this must not reach the allocator, and it should take
+ * about as long at every size. std::deque runs the same cycles in a loop
+ * of its own, timed separately for reference.
+ */
+
+static const int N_ROUND = 1000000;
+
+class Timer{
+private:
+    long dfnStart, dfnEnd;
+
+public:
+    void init() {
+        dfnEnd = dfnStart = clock();
+    }
+    void stop() {
+        dfnEnd = clock();
+    }
+    double getTime() {
+        return 1.0 * (dfnEnd - dfnStart) / CLOCKS_PER_SEC;
+    }
+};
+
+template <class Deque>
+void cycle(Deque &d, int i) {
+    d.push_back(i);
+    d.push_back(i);
+    d.pop_back();
+    d.pop_back();
+    d.push_front(i);
+    d.pop_front();
+}
+
+template <class Deque>
+double timed(Deque &d) {
+    Timer timer;
+    timer.init();
+    for (int i = 0; i < N_ROUND; i++) cycle(d, i);
+    timer.stop();
+    return timer.getTime();
+}
+
+//Each container is warmed up and timed on its own
+bool oscillate(int base, double &time, double &stdTime) {
+    std::deque<int> a;
+    sjtu::deque<int> b;
+    for (int i = 0; i < base; i++) {
+        a.push_back(i);
+        b.push_back(i);
+    }
+    for (int i = 0; i < 1000; i++) {
+        cycle(a, i);
+        cycle(b, i);
+    }
+    size_t allocs = b.allocations();
+    time = timed(b);
+    stdTime = timed(a);
+    if (b.allocations() != allocs || a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i] != b[i]) return false;
+    }
+    return true;
+}
+
+#define __OFFICAL
+
+int main() {
+    static const int BASE[] = {0, 1, 127, 128, 255, 256, 257, 383, 511, 100000};
+    puts("---------------------------------------------------------------------------");
+    puts("Oscillation around block boundaries...");
+    int n = sizeof(BASE) / sizeof(int);
+    for (int i = 0; i < n; i++) {
+        double time, stdTime;
+        bool ok = oscillate(BASE[i], time, stdTime);
+        printf("Test %d: size %-53d", i + 1, BASE[i]);
+#ifndef __OFFICAL
+        printf("%s %.2f (std::deque %.2f)\n", ok ? "PASSED" : "FAILED", time, stdTime);
+#else
+        puts(ok ? "PASSED" : "FAILED");
+#endif
+    }
+    puts("---------------------------------------------------------------------------");
+    return 0;
+}
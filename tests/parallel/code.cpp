@@ -0,0 +1,163 @@
+#include "parallel.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <thread>
+#include <vector>
+
+/*
+ * parallel.hpp against sequential loops over std::deque: for_each, both
+ * transform overloads, reduce and count_if on pools of several sizes, the
+ * empty deque, a transform into a deque with a different block layout,
+ * exceptions thrown by tasks, run() called from two threads at once and
+ * run() called from inside a task.
+ */
+
+typedef sjtu::deque<long long> Deque;
+typedef sjtu::deque<double, std::allocator<double>, sjtu::fixed_blocks<100>> Other;
+
+void build(Deque &d, std::deque<long long> &a, int n) {
+    for (int i = 0; i < n; i++) {
+        long long v = rand() % 1000;
+        if (rand() % 2) {
+            d.push_front(v);
+            a.push_front(v);
+        } else {
+            d.push_back(v);
+            a.push_back(v);
+        }
+    }
+    for (int k = 0; k < n / 100; k++) {
+        int pos = rand() % (a.size() + 1);
+        d.insert(d.begin() + pos, 7);
+        a.insert(a.begin() + pos, 7);
+    }
+}
+
+bool algorithms(sjtu::parallel::pool &p) {
+    for (int n : {0, 1, 5000, 100000, 300000}) {
+        Deque d;
+        std::deque<long long> a;
+        build(d, a, n);
+
+        long long sum = 0;
+        size_t small = 0;
+        for (long long x : a) {
+            sum += x;
+            small += x < 100;
+        }
+        if (sjtu::parallel::reduce(d, 5LL, p) != sum + 5) return false;
+        auto maxOp = [](long long x, long long y) { return x > y ? x : y; };
+        long long mx = -1;
+        for (long long x : a) mx = maxOp(mx, x);
+        if (sjtu::parallel::reduce(d, -1LL, maxOp, p) != mx) return false;
+        if (sjtu::parallel::count_if(d, [](long long x) { return x < 100; }, p) != small) return false;
+
+        sjtu::parallel::for_each(d, [](long long &x) { x += 1; }, p);
+        sjtu::parallel::transform(d, [](long long x) { return x * 3; }, p);
+        for (size_t i = 0; i < a.size(); i++) {
+            a[i] = (a[i] + 1) * 3;
+            if (d[i] != a[i]) return false;
+        }
+
+        //Small blocks filled from both ends, so no block lines up with d's
+        Other o;
+        for (size_t i = 0; i < a.size(); i++) {
+            if (i % 3) {
+                o.push_back(0);
+            } else {
+                o.push_front(0);
+            }
+        }
+        sjtu::parallel::transform(d, o, [](long long x) { return x / 2.0; }, p);
+        for (size_t i = 0; i < a.size(); i++) {
+            if (o[i] != a[i] / 2.0) return false;
+        }
+    }
+    return true;
+}
+
+bool errors(sjtu::parallel::pool &p) {
+    Deque d;
+    std::deque<long long> a;
+    build(d, a, 100000);
+    Other o;
+    o.push_back(1);
+    int caught = 0;
+    try {
+        sjtu::parallel::transform(d, o, [](long long x) { return (double)x; }, p);
+    } catch (sjtu::runtime_error &) {
+        caught++;
+    }
+    try {
+        sjtu::parallel::for_each(d, [](long long &x) {
+            if (x == 7) throw 7;
+        }, p);
+    } catch (int) {
+        caught++;
+    }
+    //The pool is still usable after a task threw
+    long long sum = 0;
+    for (long long x : a) sum += x;
+    return caught == 2 && sjtu::parallel::reduce(d, 0LL, p) == sum;
+}
+
+//Two threads sharing a pool take turns instead of mixing up their runs
+bool twoCallers(sjtu::parallel::pool &p) {
+    std::atomic<bool> ok(true);
+    auto caller = [&](int seed) {
+        for (int round = 0; round < 30; round++) {
+            std::vector<std::atomic<int>> hit(200 + seed);
+            p.run(hit.size(), [&](int t) { hit[t]++; });
+            for (auto &h : hit) {
+                if (h != 1) ok = false;
+            }
+        }
+    };
+    std::thread t1(caller, 1), t2(caller, 2);
+    t1.join();
+    t2.join();
+    return ok;
+}
+
+//A task that runs more tasks on its own pool
+bool nested(sjtu::parallel::pool &p) {
+    std::vector<std::atomic<int>> hit(64 * 64);
+    p.run(64, [&](int i) {
+        p.run(64, [&](int j) { hit[i * 64 + j]++; });
+    });
+    for (auto &h : hit) {
+        if (h != 1) return false;
+    }
+    Deque d;
+    std::deque<long long> a;
+    build(d, a, 100000);
+    long long sum = 0;
+    for (long long x : a) sum += x;
+    std::atomic<int> good(0);
+    p.run(8, [&](int) { good += sjtu::parallel::reduce(d, 0LL, p) == sum; });
+    return good == 8;
+}
+
+int main() {
+    srand(20);
+    bool ok[4] = {true, true, true, true};
+    for (unsigned workers : {1u, 2u, 4u, 0u}) {
+        sjtu::parallel::pool own(workers);
+        sjtu::parallel::pool &p = workers ? own : sjtu::parallel::default_pool();
+        ok[0] = ok[0] && algorithms(p);
+        ok[1] = ok[1] && errors(p);
+        ok[2] = ok[2] && twoCallers(p);
+        ok[3] = ok[3] && nested(p);
+    }
+    puts("---------------------------------------------------------------------------");
+    puts("parallel algorithms...");
+    printf("Test 1: for_each, transform, reduce, count_if                      %s\n", ok[0] ? "PASSED" : "FAILED");
+    printf("Test 2: exceptions                                                 %s\n", ok[1] ? "PASSED" : "FAILED");
+    printf("Test 3: run() from two threads                                     %s\n", ok[2] ? "PASSED" : "FAILED");
+    printf("Test 4: run() from inside a task                                   %s\n", ok[3] ? "PASSED" : "FAILED");
+    puts("---------------------------------------------------------------------------");
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "deque.hpp"
+#include "../common.hpp"
+
+#include <cstdio>
+#include <deque>
+#include <memory_resource>
+#include <string>
+#include <utility>
+
+/*
+ * sjtu::pmr::deque on a monotonic_buffer_resource: every allocation must
+ * reach the resource, and copies, moves and swaps must keep the contents
+ * and follow polymorphic_allocator, which never propagates.
+ */
+
+typedef sjtu::pmr::deque<std::string> Deque;
+
+void fill(Deque &b, std::deque<std::string> &a, int n, const char *tag) {
+    for (int i = 0; i < n; i++) {
+        std::string s = tag + std::to_string(i);
+        if (i % 3) {
+            a.push_back(s);
+            b.push_back(s);
+        } else {
+            a.push_front(s);
+            b.push_front(s);
+        }
+    }
+}
+
+bool onResource() {
+    counting_resource up;
+    std::pmr::monotonic_buffer_resource arena(&up);
+    Deque b(&arena);
+    std::deque<std::string> a;
+    fill(b, a, 20000, "x");
+    return up.allocs > 0 && b.get_allocator().resource() == &arena && same(b, a);
+}
+
+bool copyMove() {
+    std::pmr::monotonic_buffer_resource r1, r2;
+    Deque b(&r1);
+    std::deque<std::string> a;
+    fill(b, a, 10000, "c");
+    //A copy starts on the default resource, as polymorphic_allocator asks
+    Deque copy(b);
+    if (!same(copy, a) || copy.get_allocator().resource() != std::pmr::get_default_resource()) return false;
+    Deque moved(std::move(copy));
+    if (!same(moved, a) || !copy.empty() || moved.get_allocator() != copy.get_allocator()) return false;
+    //A different resource: the elements move over, the allocator stays
+    Deque other(&r2);
+    other = std::move(moved);
+    if (!same(other, a) || other.get_allocator().resource() != &r2) return false;
+    //Same resource: the blocks are taken over
+    Deque again(&r2);
+    again = std::move(other);
+    if (!same(again, a) || !other.empty()) return false;
+    Deque assigned(&r1);
+    assigned = again;
+    return same(assigned, a) && assigned.get_allocator().resource() == &r1;
+}
+
+bool swapped() {
+    std::pmr::monotonic_buffer_resource r;
+    Deque b(&r), d(&r);
+    std::deque<std::string> a, c;
+    fill(b, a, 5000, "s");
+    fill(d, c, 3000, "t");
+    b.swap(d);
+    if (!same(b, c) || !same(d, a)) return false;
+    swap(b, d);
+    return same(b, a) && same(d, c);
+}
+
+//Elements are built through the allocator, so they use the arena too
+bool elements() {
+    std::pmr::monotonic_buffer_resource arena;
+    sjtu::pmr::deque<std::pmr::string> b(&arena);
+    for (int i = 0; i < 5000; i++) {
+        if (i % 2) b.emplace_back(100, 'y');
+        else b.push_front(std::pmr::string(100, 'z'));
+        if (i % 7 == 0) b.emplace(b.begin() + b.size() / 3, 100, 'm');
+    }
+    for (size_t i = 0; i < b.size(); i++) {
+        if (b[i].get_allocator().resource() != &arena || b[i].size() != 100) return false;
+    }
+    return true;
+}
+
+int main() {
+    puts("---------------------------------------------------------------------------");
+    puts("pmr::deque on a monotonic_buffer_resource...");
+    printf("Test 1: allocates from the resource                                %s\n", onResource() ? "PASSED" : "FAILED");
+    printf("Test 2: copy and move                                              %s\n", copyMove() ? "PASSED" : "FAILED");
+    printf("Test 3: swap                                                       %s\n", swapped() ? "PASSED" : "FAILED");
+    printf("Test 4: elements on the resource                                   %s\n", elements() ? "PASSED" : "FAILED");
+    puts("---------------------------------------------------------------------------");
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include "deque.hpp"
+#include "../common.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <string>
+#include <vector>
+
+/*
+ * Range insert and erase against std::deque: every position of small
+ * deques with tiny blocks (so that block boundaries, block middles and
+ * both ends are all hit), empty ranges, the whole deque, and random
+ * operations on large deques.
+ */
+
+bool insertCount() {
+    for (int n = 0; n <= 24; n++) {
+        for (int pos = 0; pos <= n; pos++) {
+            for (int count : {0, 1, 3, 4, 9}) {
+                Small b;
+                std::deque<std::string> a;
+                build(b, a, n);
+                auto it = b.insert(b.begin() + pos, count, "v");
+                insertRef(a, pos, count, "v");
+                if (it - b.begin() != pos || !same(b, a)) return false;
+            }
+        }
+    }
+    return true;
+}
+
+//value is an element of the deque itself, possibly one that is moved
+bool insertAliased() {
+    for (int n = 1; n <= 24; n++) {
+        for (int pos = 0; pos <= n; pos++) {
+            for (int from = 0; from < n; from++) {
+                for (int count : {1, 3, 9}) {
+                    Small b;
+                    std::deque<std::string> a;
+                    build(b, a, n);
+                    b.insert(b.begin() + pos, count, b[from]);
+                    insertRef(a, pos, count, std::string(a[from]));
+                    if (!same(b, a)) return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool insertRange() {
+    for (int n = 0; n <= 24; n++) {
+        for (int pos = 0; pos <= n; pos++) {
+            for (int count : {0, 1, 5, 13}) {
+                std::vector<std::string> v;
+                for (int i = 0; i < count; i++) v.push_back("r" + std::to_string(i));
+                Small b;
+                std::deque<std::string> a;
+                build(b, a, n);
+                auto it = b.insert(b.begin() + pos, v.begin(), v.end());
+                insertRef(a, pos, v);
+                if (it - b.begin() != pos || !same(b, a)) return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool eraseRange() {
+    for (int n = 0; n <= 24; n++) {
+        for (int l = 0; l <= n; l++) {
+            for (int r = l; r <= n; r++) {
+                Small b;
+                std::deque<std::string> a;
+                build(b, a, n);
+                auto it = b.erase(b.begin() + l, b.begin() + r);
+                a.erase(a.begin() + l, a.begin() + r);
+                if (it - b.begin() != l || !same(b, a)) return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool whole() {
+    Small b;
+    std::deque<std::string> a;
+    build(b, a, 1000);
+    b.erase(b.begin(), b.end());
+    if (!b.empty()) return false;
+    std::vector<std::string> v(a.begin(), a.end());
+    b.insert(b.end(), v.begin(), v.end());
+    if (!same(b, a)) return false;
+    b.insert(b.begin(), 500, "w");
+    a.insert(a.begin(), 500, "w");
+    if (!same(b, a)) return false;
+    b.erase(b.begin(), b.end());
+    b.push_back("after");
+    return b.size() == 1 && b[0] == "after";
+}
+
+bool randomOps() {
+    Large b;
+    std::deque<std::string> a;
+    build(b, a, 20000);
+    for (int t = 0; t < 300; t++) {
+        int n = a.size(), pos = rand() % (n + 1), count = rand() % 3000;
+        switch (rand() % 3) {
+        case 0:
+            b.insert(b.begin() + pos, count, std::to_string(t));
+            insertRef(a, pos, count, std::to_string(t));
+            break;
+        case 1: {
+            std::vector<std::string> v;
+            for (int i = 0; i < count; i++) v.push_back(std::to_string(t * 7 + i));
+            b.insert(b.begin() + pos, v.begin(), v.end());
+            insertRef(a, pos, v);
+            break;
+        }
+        default: {
+            int r = pos + rand() % (n - pos + 1);
+            b.erase(b.begin() + pos, b.begin() + r);
+            a.erase(a.begin() + pos, a.begin() + r);
+        }
+        }
+        if (a.size() != b.size()) return false;
+    }
+    return same(b, a);
+}
+
+int main() {
+    srand(11);
+    puts("---------------------------------------------------------------------------");
+    puts("Range insert and erase...");
+    printf("Test 1: insert(pos, count, value)                                  %s\n", insertCount() ? "PASSED" : "FAILED");
+    printf("Test 2: insert(pos, count, element of the deque)                   %s\n", insertAliased() ? "PASSED" : "FAILED");
+    printf("Test 3: insert(pos, first, last)                                   %s\n", insertRange() ? "PASSED" : "FAILED");
+    printf("Test 4: erase(first, last)                                         %s\n", eraseRange() ? "PASSED" : "FAILED");
+    printf("Test 5: whole deque                                                %s\n", whole() ? "PASSED" : "FAILED");
+    printf("Test 6: random                                                     %s\n", randomOps() ? "PASSED" : "FAILED");
+    puts("---------------------------------------------------------------------------");
+    return 0;
+}
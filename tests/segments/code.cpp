@@ -0,0 +1,148 @@
+#include "deque.hpp"
+#include "../common.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iterator>
+#include <numeric>
+#include <vector>
+
+/*
+ * segments() and the whole-deque algorithms built on it: a block whose
+ * circular buffer wraps gives two segments, the segments of any deque
+ * spell out its elements in order, and for_each, accumulate, find, count,
+ * fill and copy agree with the std algorithms on std::deque.
+ */
+
+typedef small_deque<int> SmallInts;
+typedef sjtu::deque<int> LargeInts;
+
+//Random values pushed at both ends, then random inserts and pops, so that
+//many blocks wrap around
+template <class Deque>
+void scramble(Deque &b, std::deque<int> &a, int times) {
+    build(b, a, times / 2, [](int) { return rand() % 50; });
+    for (int t = 0; t < times / 2; t++) {
+        int v = rand() % 50, pos = rand() % (a.size() + 1);
+        if (rand() % 2) {
+            b.insert(b.begin() + pos, v);
+            a.insert(a.begin() + pos, v);
+        } else if (!a.empty()) {
+            b.pop_front();
+            a.pop_front();
+        }
+    }
+}
+
+//The elements as read through segments(), with the number of segments
+//and of wrapped ones
+template <class Deque>
+std::vector<int> flatten(const Deque &b, int &segs, int &wrapped) {
+    std::vector<int> v;
+    segs = wrapped = 0;
+    auto range = b.segments();
+    for (auto it = range.begin(); it != range.end(); ++it) {
+        segs++;
+        wrapped += !it.starts_block();
+        for (const int &x : *it) v.push_back(x);
+    }
+    return v;
+}
+
+bool wrappedBlock() {
+    SmallInts b;
+    b.push_back(1);
+    b.push_back(2);
+    b.push_back(3);
+    b.push_front(0);
+    int segs, wrapped;
+    std::vector<int> v = flatten(b, segs, wrapped);
+    if (segs != 2 || wrapped != 1 || v != std::vector<int>{0, 1, 2, 3}) return false;
+    auto range = b.segments();
+    auto it = range.begin();
+    if ((*it).size() != 1 || *(*it).first != 0) return false;
+    ++it;
+    if ((*it).size() != 3 || *(*it).first != 1) return false;
+    ++it;
+    if (it != range.end()) return false;
+    //Writes through the mutable segments land in the deque
+    for (auto seg : b.segments()) {
+        for (int &x : seg) x *= 10;
+    }
+    return b[0] == 0 && b[1] == 10 && b[2] == 20 && b[3] == 30;
+}
+
+bool empty() {
+    SmallInts b;
+    const SmallInts &c = b;
+    if (b.segments().begin() != b.segments().end() || c.segments().begin() != c.segments().end()) return false;
+    b.push_back(1);
+    b.pop_back();
+    int segs, wrapped;
+    return flatten(b, segs, wrapped).empty() && segs == 0;
+}
+
+template <class Deque>
+bool inOrder() {
+    int wrappedSeen = 0;
+    for (int round = 0; round < 50; round++) {
+        Deque b;
+        std::deque<int> a;
+        scramble(b, a, rand() % 5000);
+        int segs, wrapped;
+        std::vector<int> v = flatten(b, segs, wrapped);
+        if (!std::equal(v.begin(), v.end(), a.begin(), a.end())) return false;
+        wrappedSeen += wrapped;
+    }
+    return wrappedSeen > 0;
+}
+
+template <class Deque>
+bool algorithms() {
+    for (int round = 0; round < 50; round++) {
+        Deque b;
+        std::deque<int> a;
+        scramble(b, a, rand() % 5000);
+
+        sjtu::for_each(b, [](int &x) { x += 3; });
+        std::for_each(a.begin(), a.end(), [](int &x) { x += 3; });
+        if (!same(b, a)) return false;
+
+        if (sjtu::accumulate(b, 0LL) != std::accumulate(a.begin(), a.end(), 0LL)) return false;
+        auto mix = [](unsigned long long s, int x) { return s * 31 + x; };
+        if (sjtu::accumulate(b, 7ULL, mix) != std::accumulate(a.begin(), a.end(), 7ULL, mix)) return false;
+
+        for (int v : {3, 20, 52, 1000}) {
+            auto it = sjtu::find(b, v);
+            long pos = std::find(a.begin(), a.end(), v) - a.begin();
+            if (it - b.begin() != pos) return false;
+            if (it != b.end() && *it != v) return false;
+            if (sjtu::count(b, v) != (size_t)std::count(a.begin(), a.end(), v)) return false;
+        }
+
+        std::vector<int> out;
+        sjtu::copy(b, std::back_inserter(out));
+        if (!std::equal(out.begin(), out.end(), a.begin(), a.end())) return false;
+
+        sjtu::fill(b, 9);
+        std::fill(a.begin(), a.end(), 9);
+        if (!same(b, a)) return false;
+    }
+    return true;
+}
+
+int main() {
+    srand(19);
+    puts("---------------------------------------------------------------------------");
+    puts("segments and segmented algorithms...");
+    printf("Test 1: a wrapped block gives two segments                         %s\n", wrappedBlock() ? "PASSED" : "FAILED");
+    printf("Test 2: empty deque                                                %s\n", empty() ? "PASSED" : "FAILED");
+    printf("Test 3: segments in order, small blocks                            %s\n", inOrder<SmallInts>() ? "PASSED" : "FAILED");
+    printf("Test 4: segments in order, default blocks                          %s\n", inOrder<LargeInts>() ? "PASSED" : "FAILED");
+    printf("Test 5: algorithms, small blocks                                   %s\n", algorithms<SmallInts>() ? "PASSED" : "FAILED");
+    printf("Test 6: algorithms, default blocks                                 %s\n", algorithms<LargeInts>() ? "PASSED" : "FAILED");
+    puts("---------------------------------------------------------------------------");
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include "sort.hpp"
+#include "../common.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * sort and stable_sort against std::sort and std::stable_sort on a vector,
+ * on pools of one worker (sorting through a vector) and of several (sorting
+ * blocks and merging them), for deques too small and large enough to be
+ * cut into parts. Stability is checked on records with few distinct keys.
+ * A pmr deque must only reach its resource from one thread at a time.
+ */
+
+struct record {
+    int key, seq;
+    std::string pad;
+};
+
+bool byKey(const record &a, const record &b) {
+    return a.key < b.key;
+}
+
+bool sameRecord(const record &a, const record &b) {
+    return a.key == b.key && a.seq == b.seq && a.pad == b.pad;
+}
+
+const int sizes[] = {0, 1, 2, 100, 5000, 70000, 300000};
+
+bool sortInts(sjtu::parallel::pool &p) {
+    for (int n : sizes) {
+        for (int range : {5, 1000000}) {
+            sjtu::deque<int> d;
+            std::vector<int> v;
+            for (int i = 0; i < n; i++) {
+                int x = rand() % range;
+                if (rand() % 2) {
+                    d.push_back(x);
+                } else {
+                    d.push_front(x);
+                }
+            }
+            for (int x : d) v.push_back(x);
+            sjtu::sort(d, std::greater<int>(), p);
+            std::sort(v.begin(), v.end(), std::greater<int>());
+            if (!same(d, v)) return false;
+            //Still a working deque afterwards
+            d.push_front(-1);
+            d.insert(d.begin() + d.size() / 2, 7);
+            v.insert(v.begin(), -1);
+            v.insert(v.begin() + v.size() / 2, 7);
+            if (!same(d, v)) return false;
+        }
+    }
+    return true;
+}
+
+bool stable(sjtu::parallel::pool &p) {
+    for (int n : sizes) {
+        for (int keys : {1, 10, 100000}) {
+            sjtu::deque<record> d;
+            std::vector<record> v;
+            for (int i = 0; i < n; i++) {
+                record r{rand() % keys, i, std::to_string(i)};
+                if (rand() % 2) {
+                    d.push_back(r);
+                } else {
+                    d.push_front(r);
+                }
+            }
+            for (auto it = d.begin(); it != d.end(); ++it) v.push_back(*it);
+            sjtu::stable_sort(d, byKey, p);
+            std::stable_sort(v.begin(), v.end(), byKey);
+            if (!same(d, v, sameRecord)) return false;
+        }
+    }
+    return true;
+}
+
+//The overloads on the default pool, and a sort run from inside a task
+bool defaults(sjtu::parallel::pool &p) {
+    sjtu::deque<int> d;
+    std::vector<int> v;
+    for (int i = 0; i < 100000; i++) {
+        int x = rand();
+        d.push_back(x);
+        v.push_back(x);
+    }
+    std::sort(v.begin(), v.end());
+    sjtu::deque<int> e = d;
+    sjtu::sort(d);
+    sjtu::stable_sort(e);
+    if (!same(d, v) || !same(e, v)) return false;
+
+    std::vector<sjtu::deque<int>> many(4);
+    for (auto &x : many) {
+        for (int i = 0; i < 80000; i++) x.push_back(rand());
+    }
+    p.run(many.size(), [&](int t) { sjtu::sort(many[t], std::less<int>(), p); });
+    for (auto &x : many) {
+        for (size_t i = 1; i < x.size(); i++) {
+            if (x[i-1] > x[i]) return false;
+        }
+    }
+    return true;
+}
+
+//Sorting keeps the deque's memory resource
+//Passes calls on to the resource below it and counts the calls made while
+//another thread was still inside one, which a resource like
+//monotonic_buffer_resource does not survive. Yielding inside widens the
+//window, so that an overlap shows even on one core
+class overlapping : public std::pmr::memory_resource {
+public:
+    std::atomic<long> overlaps{0};
+
+    explicit overlapping(std::pmr::memory_resource *up) : up(up) {}
+
+private:
+    std::pmr::memory_resource *up;
+    std::atomic<int> inside{0};
+
+    void *do_allocate(size_t bytes, size_t align) override {
+        if (inside++) overlaps++;
+        std::this_thread::yield();
+        void *p = up->allocate(bytes, align);
+        inside--;
+        return p;
+    }
+    void do_deallocate(void *p, size_t bytes, size_t align) override {
+        if (inside++) overlaps++;
+        std::this_thread::yield();
+        up->deallocate(p, bytes, align);
+        inside--;
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+bool pmr(sjtu::parallel::pool &p) {
+    std::pmr::monotonic_buffer_resource arena;
+    overlapping guard(&arena);
+    sjtu::pmr::deque<int> d(&guard);
+    std::vector<int> v;
+    for (int i = 0; i < 100000; i++) {
+        int x = rand() % 1000;
+        d.push_back(x);
+        v.push_back(x);
+    }
+    sjtu::stable_sort(d, std::less<int>(), p);
+    std::stable_sort(v.begin(), v.end());
+    return same(d, v) && d.get_allocator().resource() == &guard && guard.overlaps == 0;
+}
+
+int main() {
+    srand(21);
+    bool ok[4] = {true, true, true, true};
+    for (unsigned workers : {1u, 2u, 4u}) {
+        sjtu::parallel::pool p(workers);
+        ok[0] = ok[0] && sortInts(p);
+        ok[1] = ok[1] && stable(p);
+        ok[2] = ok[2] && defaults(p);
+        ok[3] = ok[3] && pmr(p);
+    }
+    puts("---------------------------------------------------------------------------");
+    puts("sort and stable_sort...");
+    printf("Test 1: sort                                                       %s\n", ok[0] ? "PASSED" : "FAILED");
+    printf("Test 2: stable_sort keeps equal elements in order                  %s\n", ok[1] ? "PASSED" : "FAILED");
+    printf("Test 3: default pool and sorting from a task                       %s\n", ok[2] ? "PASSED" : "FAILED");
+    printf("Test 4: pmr deque                                                  %s\n", ok[3] ? "PASSED" : "FAILED");
+    puts("---------------------------------------------------------------------------");
+    return 0;
+}
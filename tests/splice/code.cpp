@@ -0,0 +1,228 @@
+#include "deque.hpp"
+#include "../common.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory_resource>
+#include <string>
+#include <utility>
+
+/*
+ * splice, append and prepend against std::deque: every position of small
+ * deques with tiny blocks, long chains of appends and prepends, deques on
+ * two different memory resources (where the elements have to be moved
+ * one by one), incremental blocks whose moved-from source is used again,
+ * and the iterator checks.
+ */
+
+typedef sjtu::deque<std::string, std::pmr::polymorphic_allocator<std::string>, sjtu::fixed_blocks<4>> Pmr;
+typedef sjtu::deque<std::string, std::allocator<std::string>, sjtu::incremental_blocks<>> Incremental;
+
+bool everyPosition() {
+    for (int n = 0; n <= 20; n++) {
+        for (int m : {0, 1, 3, 4, 9, 17}) {
+            for (int pos = 0; pos <= n; pos++) {
+                Small b, o;
+                std::deque<std::string> a, ao;
+                build(b, a, n, "e");
+                build(o, ao, m, "o");
+                auto it = b.splice(b.begin() + pos, std::move(o));
+                insertRef(a, pos, ao);
+                if (it - b.begin() != pos || !same(b, a) || !o.empty()) return false;
+                //Both sides must still be usable
+                o.push_back("again");
+                b.push_front("front");
+                a.push_front("front");
+                if (o.size() != 1 || o[0] != "again" || !same(b, a)) return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool ends() {
+    for (int n = 0; n <= 20; n++) {
+        for (int m = 0; m <= 20; m++) {
+            Small b, o, p;
+            std::deque<std::string> a, ao, ap;
+            build(b, a, n, "e");
+            build(o, ao, m, "o");
+            build(p, ap, m, "p");
+            b.append(std::move(o));
+            b.prepend(std::move(p));
+            insertRef(a, a.size(), ao);
+            insertRef(a, 0, ap);
+            if (!same(b, a) || !o.empty() || !p.empty()) return false;
+        }
+    }
+    return true;
+}
+
+bool chain() {
+    Large b;
+    std::deque<std::string> a;
+    for (int t = 0; t < 2000; t++) {
+        Large o;
+        std::deque<std::string> ao;
+        build(o, ao, rand() % (t % 100 ? 5 : 3000), std::to_string(t) + "_");
+        switch (rand() % 3) {
+        case 0:
+            b.append(std::move(o));
+            insertRef(a, a.size(), ao);
+            break;
+        case 1:
+            b.prepend(std::move(o));
+            insertRef(a, 0, ao);
+            break;
+        default: {
+            int pos = rand() % (a.size() + 1);
+            b.splice(b.begin() + pos, std::move(o));
+            insertRef(a, pos, ao);
+        }
+        }
+        if (a.size() != b.size()) return false;
+    }
+    return same(b, a);
+}
+
+//Unequal allocators: the elements must end up in the target's memory
+bool unequal() {
+    counting_resource r1, r2;
+    for (int m : {0, 1, 7, 100}) {
+        Pmr b(&r1);
+        std::deque<std::string> a;
+        build(b, a, 30, "e");
+        {
+            Pmr o(&r2), p(&r2), q(&r2);
+            std::deque<std::string> ao, ap, aq;
+            build(o, ao, m, "o");
+            build(p, ap, m, "p");
+            build(q, aq, m, "q");
+            b.append(std::move(o));
+            b.prepend(std::move(p));
+            auto it = b.splice(b.begin() + 15, std::move(q));
+            insertRef(a, a.size(), ao);
+            insertRef(a, 0, ap);
+            insertRef(a, 15, aq);
+            if (it - b.begin() != 15 || !o.empty() || !p.empty() || !q.empty()) return false;
+            if (b.get_allocator().resource() != &r1 || o.get_allocator().resource() != &r2) return false;
+        }
+        //Nothing of b may live in r2, which is empty once o, p and q are gone
+        if (r2.live || !same(b, a)) return false;
+    }
+    //Equal allocators relink the blocks, which then belong to the target
+    Pmr b(&r1);
+    std::deque<std::string> a;
+    build(b, a, 30, "e");
+    {
+        Pmr o(&r1);
+        std::deque<std::string> ao;
+        build(o, ao, 50, "o");
+        b.splice(b.begin() + 10, std::move(o));
+        insertRef(a, 10, ao);
+    }
+    return same(b, a);
+}
+
+//The source may have a split or merge pending, which must not follow its
+//blocks into the target
+bool incremental() {
+    for (int m : {1, 100, 193, 500}) {
+        Incremental b, o;
+        std::deque<std::string> a, ao;
+        build(b, a, 1000, "e");
+        build(o, ao, m, "o");
+        b.append(std::move(o));
+        insertRef(a, a.size(), ao);
+        if (b[0] != a[0]) return false;
+        ao.clear();
+        for (int i = 0; i < 200; i++) {
+            o.push_back("x" + std::to_string(i));
+            ao.push_back("x" + std::to_string(i));
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            if (b[i] != a[i]) return false;
+        }
+        if (!same(o, ao)) return false;
+    }
+    //Random splices, each source reused after it was moved from
+    Incremental b, o;
+    std::deque<std::string> a, ao;
+    for (int t = 0; t < 400; t++) {
+        for (int i = rand() % 300; i > 0; i--) {
+            std::string s = std::to_string(t) + "_" + std::to_string(i);
+            if (i % 2) {
+                o.push_back(s);
+                ao.push_back(s);
+            } else {
+                o.push_front(s);
+                ao.push_front(s);
+            }
+        }
+        int pos = rand() % (a.size() + 1);
+        switch (rand() % 3) {
+        case 0:
+            b.append(std::move(o));
+            insertRef(a, a.size(), ao);
+            break;
+        case 1:
+            b.prepend(std::move(o));
+            insertRef(a, 0, ao);
+            break;
+        default:
+            b.splice(b.begin() + pos, std::move(o));
+            insertRef(a, pos, ao);
+        }
+        ao.clear();
+        int k = rand() % (a.size() + 1);
+        if (k < (int)a.size() && b[k] != a[k]) return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (b[i] != a[i]) return false;
+    }
+    return same(b, a) && o.empty();
+}
+
+bool checks() {
+    Small b, o;
+    std::deque<std::string> a;
+    build(b, a, 10, "e");
+    build(o, a, 10, "o");
+    int caught = 0;
+    try {
+        b.splice(o.begin(), std::move(o));
+    } catch (sjtu::invalid_iterator &) {
+        caught++;
+    }
+    try {
+        b.splice(b.begin(), std::move(b));
+    } catch (sjtu::invalid_iterator &) {
+        caught++;
+    }
+    try {
+        b.append(std::move(b));
+    } catch (sjtu::invalid_iterator &) {
+        caught++;
+    }
+    try {
+        b.prepend(std::move(b));
+    } catch (sjtu::invalid_iterator &) {
+        caught++;
+    }
+    return caught == 4 && b.size() == 10 && o.size() == 10;
+}
+
+int main() {
+    srand(12);
+    puts("---------------------------------------------------------------------------");
+    puts("splice, append and prepend...");
+    printf("Test 1: splice at every position                                   %s\n", everyPosition() ? "PASSED" : "FAILED");
+    printf("Test 2: append and prepend                                         %s\n", ends() ? "PASSED" : "FAILED");
+    printf("Test 3: long chain                                                 %s\n", chain() ? "PASSED" : "FAILED");
+    printf("Test 4: unequal allocators                                         %s\n", unequal() ? "PASSED" : "FAILED");
+    printf("Test 5: incremental blocks, source reused                          %s\n", incremental() ? "PASSED" : "FAILED");
+    printf("Test 6: iterator checks                                            %s\n", checks() ? "PASSED" : "FAILED");
+    puts("---------------------------------------------------------------------------");
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include "deque.hpp"
+#include "../common.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory_resource>
+#include <string>
+#include <utility>
+
+/*
+ * split against std::deque: every position of small deques with tiny
+ * blocks, both halves still usable afterwards, splitting and splicing back
+ * on large deques, and the allocation counters of the returned tail,
+ * which takes over the blocks it was handed.
+ */
+
+typedef sjtu::deque<std::string, std::pmr::polymorphic_allocator<std::string>, sjtu::fixed_blocks<4>> Pmr;
+
+bool everyPosition() {
+    for (int n = 0; n <= 24; n++) {
+        for (int pos = 0; pos <= n; pos++) {
+            Small b;
+            std::deque<std::string> a;
+            build(b, a, n);
+            Small t = b.split(b.begin() + pos);
+            std::deque<std::string> at(a.begin() + pos, a.end());
+            a.erase(a.begin() + pos, a.end());
+            if (!same(b, a) || !same(t, at)) return false;
+            //Both halves must still be usable
+            for (int i = 0; i < 6; i++) {
+                b.push_back("b" + std::to_string(i));
+                a.push_back("b" + std::to_string(i));
+                t.push_front("t" + std::to_string(i));
+                at.push_front("t" + std::to_string(i));
+            }
+            t.insert(t.begin() + t.size() / 2, "mid");
+            at.insert(at.begin() + at.size() / 2, "mid");
+            if (!same(b, a) || !same(t, at)) return false;
+        }
+    }
+    return true;
+}
+
+bool splitAndJoin() {
+    Large b;
+    std::deque<std::string> a;
+    build(b, a, 50000);
+    for (int t = 0; t < 200; t++) {
+        int pos = rand() % (a.size() + 1);
+        Large tail = b.split(b.begin() + pos);
+        if (b.size() != (size_t)pos || tail.size() != a.size() - pos) return false;
+        if (pos < (int)a.size() && tail.front() != a[pos]) return false;
+        if (pos && b.back() != a[pos - 1]) return false;
+        if (rand() % 2) {
+            b.append(std::move(tail));
+        } else {
+            tail.prepend(std::move(b));
+            b = std::move(tail);
+        }
+    }
+    return same(b, a);
+}
+
+//What each deque reports as still allocated is exactly what it holds
+bool counters() {
+    counting_resource r;
+    for (int n : {0, 1, 5, 100, 1000}) {
+        for (int pos : {0, 1, 3, 50, 999}) {
+            if (pos > n) continue;
+            Pmr *b = new Pmr(&r);
+            std::deque<std::string> a;
+            build(*b, a, n);
+            Pmr t = b->split(b->begin() + pos);
+            if (held(*b) + held(t) != r.live) return false;
+            delete b;
+            if (held(t) != r.live) return false;
+            std::deque<std::string> at(a.begin() + pos, a.end());
+            if (!same(t, at)) return false;
+        }
+    }
+    return r.live == 0;
+}
+
+bool checks() {
+    Small b, o;
+    std::deque<std::string> a;
+    build(b, a, 10);
+    build(o, a, 10);
+    try {
+        b.split(o.begin());
+    } catch (sjtu::invalid_iterator &) {
+        return b.size() == 10 && o.size() == 10;
+    }
+    return false;
+}
+
+int main() {
+    srand(13);
+    puts("---------------------------------------------------------------------------");
+    puts("split...");
+    printf("Test 1: split at every position                                    %s\n", everyPosition() ? "PASSED" : "FAILED");
+    printf("Test 2: split and join                                             %s\n", splitAndJoin() ? "PASSED" : "FAILED");
+    printf("Test 3: allocation counters                                        %s\n", counters() ? "PASSED" : "FAILED");
+    printf("Test 4: iterator checks                                            %s\n", checks() ? "PASSED" : "FAILED");
+    puts("---------------------------------------------------------------------------");
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "spsc.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/*
+ * Single producer, single consumer handoff: one thread pushes N items,
+ * another pops them and checks they arrive complete and in order.
+ * spsc_deque is timed against a std::deque guarded by a std::mutex.
+ */
+
+#define __OFFICAL
+
+static const int N = 4000000;
+
+struct Locked {
+    std::mutex m;
+    std::deque<long long> q;
+
+    void push_back(long long x) {
+        std::lock_guard<std::mutex> lock(m);
+        q.push_back(x);
+    }
+    bool try_pop_front(long long &x) {
+        std::lock_guard<std::mutex> lock(m);
+        if (q.empty()) return false;
+        x = q.front();
+        q.pop_front();
+        return true;
+    }
+};
+
+template <class Queue>
+bool handoff(double &rate) {
+    Queue q;
+    bool ok = true;
+    auto start = std::chrono::steady_clock::now();
+    std::thread consumer([&] {
+        long long x;
+        for (long long i = 0; i < N; i++) {
+            while (!q.try_pop_front(x)) std::this_thread::yield();
+            if (x != i) ok = false;
+        }
+    });
+    for (long long i = 0; i < N; i++) q.push_back(i);
+    consumer.join();
+    rate = N / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return ok;
+}
+
+//Elements left behind are destroyed with the queue
+bool leftovers() {
+    sjtu::spsc_deque<std::string, std::allocator<std::string>, sjtu::fixed_blocks<4>> q;
+    std::string s;
+    for (int i = 0; i < 100; i++) q.push_back(std::string(40, 'a' + i % 26));
+    for (int i = 0; i < 50; i++) {
+        if (!q.try_pop_front(s) || s != std::string(40, 'a' + i % 26)) return false;
+    }
+    for (int i = 0; i < 100; i++) q.emplace_back(40, 'z');
+    return !q.empty();
+}
+
+int main() {
+    puts("---------------------------------------------------------------------------");
+    puts("Single producer, single consumer...");
+    double fast, slow;
+    bool ok = handoff<sjtu::spsc_deque<long long>>(fast);
+    printf("Test 1: spsc_deque                                                 %s\n", ok ? "PASSED" : "FAILED");
+    ok = handoff<Locked>(slow);
+    printf("Test 2: mutex and std::deque                                       %s\n", ok ? "PASSED" : "FAILED");
+    printf("Test 3: leftovers                                                  %s\n", leftovers() ? "PASSED" : "FAILED");
+#ifndef __OFFICAL
+    printf("spsc_deque %.1fM items/s, mutex and std::deque %.1fM items/s\n", fast / 1e6, slow / 1e6);
+#endif
+    puts("---------------------------------------------------------------------------");
+    return 0;
+}
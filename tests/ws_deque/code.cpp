@@ -0,0 +1,125 @@
+#include "ws_deque.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Work-stealing scheduler benchmark: fib(N) as a tree of tasks. A task
+ * n >= CUTOFF pushes n-1 and n-2 onto its worker's queue, smaller ones are
+ * computed directly. Idle workers steal from random victims. Per-worker
+ * queues of ws_deque are timed against std::deque guarded by a mutex.
+ */
+
+#define __OFFICAL
+
+static const int N = 34;
+static const int CUTOFF = 8;
+
+struct Locked {
+    std::mutex m;
+    std::deque<int> q;
+
+    void push_back(int x) {
+        std::lock_guard<std::mutex> lock(m);
+        q.push_back(x);
+    }
+    bool try_pop_back(int &x) {
+        std::lock_guard<std::mutex> lock(m);
+        if (q.empty()) return false;
+        x = q.back();
+        q.pop_back();
+        return true;
+    }
+    bool try_steal(int &x) {
+        std::lock_guard<std::mutex> lock(m);
+        if (q.empty()) return false;
+        x = q.front();
+        q.pop_front();
+        return true;
+    }
+};
+
+long long fib(int n) {
+    return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+template <class Queue>
+long long schedule(unsigned workers, double &time) {
+    std::vector<std::unique_ptr<Queue>> queues;
+    for (unsigned i = 0; i < workers; i++) queues.emplace_back(new Queue);
+    std::vector<long long> sum(workers, 0);
+    std::atomic<long long> pending(1);  //tasks pushed but not finished
+    queues[0]->push_back(N);
+    auto work = [&](unsigned self) {
+        unsigned seed = self * 2654435761u + 1;
+        long long local = 0;
+        int n;
+        while (pending.load(std::memory_order_acquire)) {
+            bool got = queues[self]->try_pop_back(n);
+            if (!got) {
+                seed = seed * 1103515245u + 12345u;
+                unsigned victim = (seed >> 16) % workers;
+                if (victim != self) got = queues[victim]->try_steal(n);
+            }
+            if (!got) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (n < CUTOFF) {
+                local += fib(n);
+                pending.fetch_sub(1, std::memory_order_acq_rel);
+            } else {
+                pending.fetch_add(1, std::memory_order_relaxed);
+                queues[self]->push_back(n - 2);
+                queues[self]->push_back(n - 1);
+            }
+        }
+        sum[self] = local;
+    };
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < workers; i++) threads.emplace_back(work, i);
+    work(0);
+    for (auto &t : threads) t.join();
+    time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    long long total = 0;
+    for (long long x : sum) total += x;
+    return total;
+}
+
+//Owner pops newest first and growth keeps every element
+bool sequential() {
+    sjtu::ws_deque<int> q(2);
+    int x;
+    for (int i = 0; i < 1000; i++) q.push_back(i);
+    for (int i = 0; i < 10; i++) {
+        if (!q.try_steal(x) || x != i) return false;
+    }
+    for (int i = 999; i >= 10; i--) {
+        if (!q.try_pop_back(x) || x != i) return false;
+    }
+    return q.empty() && !q.try_pop_back(x) && !q.try_steal(x);
+}
+
+int main() {
+    unsigned workers = std::thread::hardware_concurrency();
+    if (workers < 2) workers = 2;
+    long long answer = fib(N);
+    double fast, slow;
+    puts("---------------------------------------------------------------------------");
+    puts("Work-stealing fib...");
+    printf("Test 1: owner and thief ends                                       %s\n", sequential() ? "PASSED" : "FAILED");
+    printf("Test 2: ws_deque scheduler                                         %s\n", schedule<sjtu::ws_deque<int>>(workers, fast) == answer ? "PASSED" : "FAILED");
+    printf("Test 3: mutex and std::deque scheduler                             %s\n", schedule<Locked>(workers, slow) == answer ? "PASSED" : "FAILED");
+#ifndef __OFFICAL
+    printf("%u workers: ws_deque %.1fms, mutex and std::deque %.1fms\n", workers, fast, slow);
+#endif
+    puts("---------------------------------------------------------------------------");
+    return 0;
+}
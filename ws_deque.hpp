@@ -0,0 +1,165 @@
+#ifndef SJTU_WS_DEQUE_HPP
+#define SJTU_WS_DEQUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace sjtu {
+
+    /**
+     * Chase-Lev work-stealing deque, with the memory orderings of Le et
+     * al., "Correct and Efficient Work-Stealing for Weak Memory Models".
+     * One owner thread pushes and pops at the back, any number of thieves
+     * steal from the front. The elements sit in a circular array that the
+     * owner doubles when it is full. Thieves may still be reading an old
+     * array, so old arrays are only freed with the deque.
+     * Slots are read racily by thieves that then lose the race for them,
+     * so T must be trivially copyable, typically a task pointer or index.
+     */
+    template <class T, class Allocator = std::allocator<T>>
+    class ws_deque {
+        static_assert(std::is_trivially_copyable<T>::value, "ws_deque elements must be trivially copyable");
+
+    private:
+        struct array {
+            long long mask;  //capacity - 1, the capacity being a power of two
+            std::atomic<T> *slots;
+            array *older;  //the array this one replaced
+
+            T get(long long i) const {
+                return slots[i & mask].load(std::memory_order_relaxed);
+            }
+            void put(long long i, T x) {
+                slots[i & mask].store(x, std::memory_order_relaxed);
+            }
+        };
+
+        typedef std::allocator_traits<Allocator> traits;
+        typedef typename traits::template rebind_alloc<array> array_allocator;
+        typedef typename traits::template rebind_alloc<std::atomic<T>> slot_allocator;
+        typedef std::allocator_traits<array_allocator> array_traits;
+        typedef std::allocator_traits<slot_allocator> slot_traits;
+
+        Allocator alloc;
+        alignas(64) std::atomic<long long> top;  //next element to steal
+        alignas(64) std::atomic<long long> bottom;  //next free slot of the owner
+        std::atomic<array *> arr;
+
+        array *makeArray(long long cap, array *older) {
+            array_allocator aa(alloc);
+            slot_allocator sa(alloc);
+            array *a = array_traits::allocate(aa, 1);
+            try {
+                a->slots = slot_traits::allocate(sa, cap);
+            } catch (...) {
+                array_traits::deallocate(aa, a, 1);
+                throw;
+            }
+            for (long long i = 0; i < cap; i++) new (a->slots + i) std::atomic<T>();
+            a->mask = cap - 1;
+            a->older = older;
+            return a;
+        }
+
+        //Owner: a twice as large copy of a holding the elements [t, b)
+        array *grow(array *a, long long t, long long b) {
+            array *g = makeArray(2 * (a->mask + 1), a);
+            for (long long i = t; i < b; i++) g->put(i, a->get(i));
+            arr.store(g, std::memory_order_release);
+            return g;
+        }
+
+    public:
+        explicit ws_deque(size_t capacity = 64, const Allocator &alloc = Allocator()) : alloc(alloc), top(0), bottom(0) {
+            long long cap = 2;
+            for (; cap < (long long)capacity; cap *= 2);
+            arr.store(makeArray(cap, nullptr), std::memory_order_relaxed);
+        }
+
+        ws_deque(const ws_deque &) = delete;
+        ws_deque &operator=(const ws_deque &) = delete;
+
+        ~ws_deque() {
+            array_allocator aa(alloc);
+            slot_allocator sa(alloc);
+            for (array *a = arr.load(std::memory_order_relaxed); a; ) {
+                array *tmp = a->older;
+                slot_traits::deallocate(sa, a->slots, a->mask + 1);
+                array_traits::deallocate(aa, a, 1);
+                a = tmp;
+            }
+        }
+
+        /**
+         * Owner only.
+         */
+        void push_back(T x) {
+            long long b = bottom.load(std::memory_order_relaxed);
+            long long t = top.load(std::memory_order_acquire);
+            array *a = arr.load(std::memory_order_relaxed);
+            if (b - t > a->mask) a = grow(a, t, b);
+            a->put(b, x);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        /**
+         * Owner only: take the newest element into out.
+         * Returns false, leaving out as it was, if the deque is empty or a
+         * thief took the last element first.
+         */
+        bool try_pop_back(T &out) {
+            long long b = bottom.load(std::memory_order_relaxed) - 1;
+            array *a = arr.load(std::memory_order_relaxed);
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            long long t = top.load(std::memory_order_relaxed);
+            bool ok = true;
+            if (t <= b) {
+                T x = a->get(b);
+                if (t == b) {
+                    //The last element, race the thieves for it
+                    ok = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                    bottom.store(b + 1, std::memory_order_relaxed);
+                }
+                if (ok) out = x;
+            } else {
+                ok = false;
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return ok;
+        }
+
+        /**
+         * Any thread: take the oldest element into out.
+         * Returns false if the deque is empty or another thread took that
+         * element first.
+         */
+        bool try_steal(T &out) {
+            long long t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            long long b = bottom.load(std::memory_order_acquire);
+            if (t >= b) return false;
+            array *a = arr.load(std::memory_order_acquire);
+            T x = a->get(t);
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return false;
+            out = x;
+            return true;
+        }
+
+        //A snapshot, exact only when no other thread is working on the deque
+        size_t size() const {
+            long long b = bottom.load(std::memory_order_relaxed), t = top.load(std::memory_order_relaxed);
+            return b > t ? b - t : 0;
+        }
+        bool empty() const {
+            return size() == 0;
+        }
+    };
+
+}  // namespace sjtu
+
+#endif